@@ -0,0 +1,126 @@
+#ifndef BENCH_ALLOC_TRACKING_H_
+#define BENCH_ALLOC_TRACKING_H_
+
+// Replaces the global allocation functions to count what a piece of code
+// allocates. get_temporary_buffer, which std::inplace_merge and
+// std::stable_sort use for their buffers, goes through the nothrow
+// operator new in libstdc++ and libc++, so it is counted as well.
+// The counters are atomic since parallel sorts allocate from several
+// threads; include in a single translation unit.
+//
+// With fresh_pages(true), blocks of a page or more are mapped directly
+// from the system and unmapped when freed, so that every such allocation
+// pays for its page faults like the first allocation of a process would,
+// instead of reusing pages malloc already touched.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define BENCH_HAS_MMAP
+#endif
+
+namespace alloc_tracking {
+    struct stats {
+        std::atomic<std::size_t> live{0};
+        std::atomic<std::size_t> peak{0};
+        std::atomic<std::size_t> count{0};
+    };
+
+    inline stats& current() {
+        static stats s;
+        return s;
+    }
+
+    inline bool& fresh_pages_flag() {
+        static bool fresh = false;
+        return fresh;
+    }
+
+    inline void fresh_pages(bool fresh) {
+        fresh_pages_flag() = fresh;
+    }
+
+    // Every block is prefixed with its size and with whether it was
+    // mapped, so that deallocations can be accounted for.
+    constexpr std::size_t header = alignof(std::max_align_t) >= 2 * sizeof(std::size_t)
+                                 ? alignof(std::max_align_t) : 2 * sizeof(std::size_t);
+
+    inline void* allocate(std::size_t size) noexcept {
+        void* p = nullptr;
+        std::size_t mapped = 0;
+#ifdef BENCH_HAS_MMAP
+        if (fresh_pages_flag() && size + header >= std::size_t(sysconf(_SC_PAGESIZE))) {
+            p = mmap(nullptr, size + header, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) return nullptr;
+            mapped = 1;
+        }
+#endif
+        if (!mapped) p = std::malloc(size + header);
+        if (!p) return nullptr;
+        static_cast<std::size_t*>(p)[0] = size;
+        static_cast<std::size_t*>(p)[1] = mapped;
+        stats& s = current();
+        std::size_t live = s.live.fetch_add(size, std::memory_order_relaxed) + size;
+        s.count.fetch_add(1, std::memory_order_relaxed);
+        std::size_t peak = s.peak.load(std::memory_order_relaxed);
+        while (live > peak && !s.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+        return static_cast<char*>(p) + header;
+    }
+
+    inline void deallocate(void* p) noexcept {
+        if (!p) return;
+        char* block = static_cast<char*>(p) - header;
+        std::size_t size = reinterpret_cast<std::size_t*>(block)[0];
+        current().live.fetch_sub(size, std::memory_order_relaxed);
+#ifdef BENCH_HAS_MMAP
+        if (reinterpret_cast<std::size_t*>(block)[1]) {
+            munmap(block, size + header);
+            return;
+        }
+#endif
+        std::free(block);
+    }
+
+    // Measures the scratch memory allocated during its lifetime on top of
+    // what was already allocated when it was created.
+    struct scope {
+        std::size_t base;
+        std::size_t count_base;
+
+        scope() : base(current().live.load()), count_base(current().count.load()) {
+            current().peak.store(base);
+        }
+
+        std::size_t peak_bytes() const { return current().peak - base; }
+        std::size_t allocations() const { return current().count - count_base; }
+    };
+}
+
+void* operator new(std::size_t size) {
+    void* p = alloc_tracking::allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    void* p = alloc_tracking::allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return alloc_tracking::allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return alloc_tracking::allocate(size); }
+
+void operator delete(void* p) noexcept { alloc_tracking::deallocate(p); }
+void operator delete[](void* p) noexcept { alloc_tracking::deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { alloc_tracking::deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { alloc_tracking::deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { alloc_tracking::deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { alloc_tracking::deallocate(p); }
+
+#endif // BENCH_ALLOC_TRACKING_H_
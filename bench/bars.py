@@ -24,9 +24,12 @@ distribution_names = {
 for filename in os.listdir("profiles"):
     data = {}
     for line in open(os.path.join("profiles", filename)):
-        size, distribution, algo, *results = line.split()
+        size, distribution, algo, peak_bytes, allocations, *results = line.split()
+        # Only the int results are plotted
+        distribution, type = distribution.rsplit("_", 1)
+        if type != "int": continue
         size = int(size)
-        distribution = distribution_names[distribution]
+        distribution = distribution_names[distribution + "_int"]
         results = [int(result) for result in results]
         if not size in data: data[size] = {}
         if not distribution in data[size]: data[size][distribution] = {}
@@ -9,183 +9,231 @@
 #include <type_traits>
 #include <functional>
 #include <string>
+#include <list>
+#include <climits>
+#include <iterator>
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__GLIBCXX__) && defined(_OPENMP)
+    #include <parallel/algorithm>
+    #define BENCH_GNU_PARALLEL
+#endif
 
 #include "../pdqsort.h"
 #include "../vergesort.h"
+#include "../vergesort_adaptive.h"
+#include "../vergesort_radix.h"
 #include "timsort.h"
+#include "alloc_tracking.h"
+#include "distributions.h"
+#include "rdtsc.h"
 
-#ifdef _WIN32
-    #include <intrin.h>
-    #define rdtsc __rdtsc
-#else
-    #ifdef __i386__
-        static __inline__ unsigned long long rdtsc() {
-            unsigned long long int x;
-            __asm__ volatile(".byte 0x0f, 0x31" : "=A" (x));
-            return x;
-        }
-    #elif defined(__x86_64__)
-        static __inline__ unsigned long long rdtsc(){
-            unsigned hi, lo;
-            __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
-            return ((unsigned long long) lo) | (((unsigned long long) hi) << 32);
-        }
-    #else
-        #error no rdtsc implementation
-    #endif
-#endif
-
-
-inline std::vector<int> shuffled_int(size_t size, std::mt19937_64& rng) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 0; i < size; ++i) v.push_back(i);
-    std::shuffle(v.begin(), v.end(), rng);
-    return v;
-}
-
-inline std::vector<int> shuffled_16_values_int(size_t size, std::mt19937_64& rng) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 0; i < size; ++i) v.push_back(i % 16);
-    std::shuffle(v.begin(), v.end(), rng);
-    return v;
+template<class Iter, class Compare>
+void heapsort(Iter begin, Iter end, Compare comp) {
+    std::make_heap(begin, end, comp);
+    std::sort_heap(begin, end, comp);
 }
 
-inline std::vector<int> all_equal_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 0; i < size; ++i) v.push_back(0);
-    return v;
+template<class Iter, class Compare>
+void std_stable_sort(Iter begin, Iter end, Compare comp) {
+    std::stable_sort(begin, end, comp);
 }
 
-inline std::vector<int> ascending_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 0; i < size; ++i) v.push_back(i);
-    return v;
+// Includes copying the elements to the list and back, which is what
+// sorting a vector with std::list::sort costs.
+template<class Iter, class Compare>
+void list_sort(Iter begin, Iter end, Compare comp) {
+    std::list<typename std::iterator_traits<Iter>::value_type> list(begin, end);
+    list.sort(comp);
+    std::copy(list.begin(), list.end(), begin);
 }
 
-inline std::vector<int> descending_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = size - 1; i >= 0; --i) v.push_back(i);
-    return v;
+#ifdef BENCH_GNU_PARALLEL
+template<class Iter, class Compare>
+void gnu_parallel_sort(Iter begin, Iter end, Compare comp) {
+    __gnu_parallel::sort(begin, end, comp);
 }
 
-inline std::vector<int> pipe_organ_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 0; i < size/2; ++i) v.push_back(i);
-    for (int i = size/2; i < size; ++i) v.push_back(size - i);
-    return v;
+template<class Iter, class Compare>
+void gnu_parallel_stable_sort(Iter begin, Iter end, Compare comp) {
+    __gnu_parallel::stable_sort(begin, end, comp);
 }
+#endif
 
-inline std::vector<int> push_front_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 1; i < size; ++i) v.push_back(i);
-    v.push_back(0);
-    return v;
+// LSD radix sort baseline, does nothing for types other than integers.
+template<class Iter, class Compare>
+void radix_sort(Iter begin, Iter end, Compare) {
+    typedef typename std::iterator_traits<Iter>::value_type T;
+    vergesort_detail::radix_sort_if_possible(begin, end, vergesort_detail::is_radix_sortable<T, Compare>());
 }
 
-inline std::vector<int> push_middle_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 0; i < size; ++i) {
-        if (i != size/2) v.push_back(i);
-    }
-    v.push_back(size/2);
-    return v;
+// Evicts the input from the caches by sweeping a buffer much bigger
+// than the last level cache.
+volatile char sink;
+void flush_caches() {
+    static std::vector<char> sweep(256 << 20);
+    for (std::size_t i = 0; i < sweep.size(); i += 64) sweep[i] += 1;
+    sink = sweep[sweep.size() / 2];
 }
 
-inline std::vector<int> ascending_sawtooth_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    int limit = size / log2(size) * 1.1;
-    for (int i = 0; i < size; ++i) v.push_back(i % limit);
-    return v;
+// The distributions generate ints, other types are obtained with an
+// order-preserving conversion.
+template<class T>
+T convert(int value) {
+    return static_cast<T>(value);
 }
 
-inline std::vector<int> descending_sawtooth_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    int limit = size / log2(size) * 1.1;
-    for (int i = size - 1; i >= 0; --i) v.push_back(i % limit);
-    return v;
+template<>
+std::string convert<std::string>(int value) {
+    std::string digits = std::to_string(static_cast<long long>(value) - INT_MIN);
+    return std::string(10 - digits.size(), '0') + digits;
 }
 
-inline std::vector<int> alternating_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 0; i < size; ++i) v.push_back(i);
-    for (int i = 0; i < size; i += 2) v[i] *= -1;
-    return v;
+template<class T>
+std::vector<std::pair<std::string, void (*)(typename std::vector<T>::iterator,
+                                            typename std::vector<T>::iterator,
+                                            std::less<T>)>> sorts_for() {
+    typedef typename std::vector<T>::iterator Iter;
+    typedef std::less<T> Less;
+    std::vector<std::pair<std::string, void (*)(Iter, Iter, Less)>> sorts = {
+        {"heapsort", &heapsort<Iter, Less>},
+        {"introsort", &std::sort<Iter, Less>},
+        {"pdqsort", &pdqsort<Iter, Less>},
+        {"vergesort", &vergesort<Iter, Less>},
+        {"timsort", &gfx::timsort<Iter, Less>},
+        {"std_stable_sort", &std_stable_sort<Iter, Less>},
+        {"list_sort", &list_sort<Iter, Less>},
+#ifdef BENCH_GNU_PARALLEL
+        {"gnu_parallel_sort", &gnu_parallel_sort<Iter, Less>},
+        {"gnu_parallel_stable_sort", &gnu_parallel_stable_sort<Iter, Less>},
+#endif
+    };
+    if (std::is_integral<T>::value) sorts.push_back({"radix_sort", &radix_sort<Iter, Less>});
+    return sorts;
 }
 
-inline std::vector<int> alternating_16_values_int(size_t size, std::mt19937_64&) {
-    std::vector<int> v; v.reserve(size);
-    for (int i = 0; i < size; ++i) v.push_back(i % 16);
-    for (int i = 0; i < size; i += 2) v[i] *= -1;
-    return v;
+struct options {
+    bool cold = false;
+    // Empty when every type or sort is run
+    std::vector<std::string> types;
+    std::vector<std::string> sorts;
+    // Time spent on every distribution and sort, negative for the default
+    // of 10 s for int and 1 s for the other types
+    double seconds = -1.0;
+};
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> res;
+    std::string::size_type begin = 0;
+    while (begin <= list.size()) {
+        std::string::size_type end = list.find(',', begin);
+        if (end == std::string::npos) end = list.size();
+        if (end > begin) res.push_back(list.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return res;
 }
 
-
-template<class Iter, class Compare>
-void heapsort(Iter begin, Iter end, Compare comp) {
-    std::make_heap(begin, end, comp);
-    std::sort_heap(begin, end, comp);
+bool selected(const std::vector<std::string>& filter, const std::string& name) {
+    return filter.empty() || std::find(filter.begin(), filter.end(), name) != filter.end();
 }
 
+template<class T>
+void run(const std::string& type, const options& opts, std::time_t seed) {
+    if (!selected(opts.types, type)) return;
 
-
-int main() {
-    auto seed = std::time(0);
     std::mt19937_64 el;
-
-    typedef std::vector<int> (*DistrF)(size_t, std::mt19937_64&);
-    typedef void (*SortF)(std::vector<int>::iterator, std::vector<int>::iterator, std::less<int>);
-
-    std::pair<std::string, DistrF> distributions[] = {
-        {"shuffled_int", shuffled_int},
-        {"shuffled_16_values_int", shuffled_16_values_int},
-        {"all_equal_int", all_equal_int},
-        {"ascending_int", ascending_int},
-        {"descending_int", descending_int},
-        {"pipe_organ_int", pipe_organ_int},
-        {"push_front_int", push_front_int},
-        {"push_middle_int", push_middle_int},
-        {"ascending_sawtooth_int", ascending_sawtooth_int},
-        {"descending_sawtooth_int", descending_sawtooth_int},
-        {"alternating_int", alternating_int},
-        {"alternating_16_values_int", alternating_16_values_int}
-    };
-
-    std::pair<std::string, SortF> sorts[] = {
-        {"heapsort", &heapsort<std::vector<int>::iterator, std::less<int>>},
-        {"introsort", &std::sort<std::vector<int>::iterator, std::less<int>>},
-        {"pdqsort", &pdqsort<std::vector<int>::iterator, std::less<int>>},
-        {"vergesort", &vergesort<std::vector<int>::iterator, std::less<int>>},
-        {"timsort", &gfx::timsort<std::vector<int>::iterator, std::less<int>>}
-    };
-
     int sizes[] = {1000000};
+    double seconds = opts.seconds >= 0.0 ? opts.seconds : type == "int" ? 10.0 : 1.0;
 
     for (auto& distribution : distributions) {
-        for (auto& sort : sorts) {
+        for (auto& sort : sorts_for<T>()) {
+            if (!selected(opts.sorts, sort.first)) continue;
             el.seed(seed);
 
             for (auto size : sizes) {
                 std::chrono::time_point<std::chrono::high_resolution_clock> total_start, total_end;
                 std::vector<uint64_t> cycles;
+                std::size_t peak_bytes = 0;
+                std::size_t allocations = 0;
 
                 total_start = std::chrono::high_resolution_clock::now();
-                total_end = std::chrono::high_resolution_clock::now();
-                while (std::chrono::duration_cast<std::chrono::milliseconds>(total_end - total_start).count() < 10000) {
-                    std::vector<int> v = distribution.second(size, el);
+                do {
+                    std::vector<int> input = distribution.second(size, el);
+                    std::vector<T> v;
+                    v.reserve(size);
+                    for (int value : input) v.push_back(convert<T>(value));
+                    if (opts.cold) flush_caches();
+                    alloc_tracking::scope scope;
                     uint64_t start = rdtsc();
-                    sort.second(v.begin(), v.end(), std::less<int>());
+                    sort.second(v.begin(), v.end(), std::less<T>());
                     uint64_t end = rdtsc();
+                    peak_bytes = std::max(peak_bytes, scope.peak_bytes());
+                    allocations = std::max(allocations, scope.allocations());
                     cycles.push_back(double(end - start) / size + 0.5);
                     total_end = std::chrono::high_resolution_clock::now();
-                }
+                } while (std::chrono::duration<double>(total_end - total_start).count() < seconds);
 
                 std::sort(cycles.begin(), cycles.end());
 
-                std::cerr << size << " " << distribution.first << " " << sort.first << "\n";
-                std::cout << size << " " << distribution.first << " " << sort.first << " ";
+                std::string name = distribution.first + "_" + type;
+                std::cerr << size << " " << name << " " << sort.first << "\n";
+                // Worst scratch memory and number of allocations of a
+                // single sort come before the cycles per element
+                std::cout << size << " " << name << " " << sort.first << " ";
+                std::cout << peak_bytes << " " << allocations << " ";
                 for (uint64_t cycle : cycles) std::cout << cycle << " ";
                 std::cout << "\n";
             }
         }
     }
 }
+
+
+
+// Usage: bench [hot|cold|first_touch] [--types=LIST] [--sorts=LIST] [--seconds=S]
+//   hot          the input is generated right before being sorted (default)
+//   cold         the caches are flushed before every sort
+//   first_touch  same as cold, and every scratch buffer the sorts allocate
+//                comes from freshly mapped pages
+//   --types      comma-separated types to run among int, int64, double and
+//                string (default: all of them)
+//   --sorts      comma-separated sorts to run (default: all of them)
+//   --seconds    time spent on every distribution and sort (default: 10 for
+//                int, 1 for the other types)
+//
+// Build with -fopenmp to include the libstdc++ parallel mode sorts.
+int main(int argc, char** argv) {
+    const std::string usage = std::string("usage: ") + argv[0]
+        + " [hot|cold|first_touch] [--types=LIST] [--sorts=LIST] [--seconds=S]\n";
+    const std::vector<std::string> types = {"int", "int64", "double", "string"};
+
+    std::string mode = "hot";
+    options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "hot" || arg == "cold" || arg == "first_touch") mode = arg;
+        else if (arg.compare(0, 8, "--types=") == 0) opts.types = split(arg.substr(8));
+        else if (arg.compare(0, 8, "--sorts=") == 0) opts.sorts = split(arg.substr(8));
+        else if (arg.compare(0, 10, "--seconds=") == 0) opts.seconds = std::atof(arg.c_str() + 10);
+        else {
+            std::cerr << usage;
+            return 1;
+        }
+    }
+    for (auto& type : opts.types) {
+        if (std::find(types.begin(), types.end(), type) == types.end()) {
+            std::cerr << "unknown type " << type << "\n" << usage;
+            return 1;
+        }
+    }
+    opts.cold = mode != "hot";
+    alloc_tracking::fresh_pages(mode == "first_touch");
+
+    auto seed = std::time(0);
+    run<int>("int", opts, seed);
+    run<long long>("int64", opts, seed);
+    run<double>("double", opts, seed);
+    run<std::string>("string", opts, seed);
+}
@@ -0,0 +1,94 @@
+// Spawns N processes on the local machine, each generating a slice of a
+// random collection, and sorts them with distributed_vergesort over Unix
+// domain sockets. Checks the global order and reports the throughput.
+//
+// Usage: distributed [processes] [elements per process]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../distributed_vergesort.h"
+#include "../unix_socket_transport.h"
+
+int run_rank(const std::string& directory, int rank, int size, std::size_t count) {
+    unix_socket_transport transport(directory, rank, size);
+
+    std::mt19937_64 rng(rank + 1);
+    std::vector<std::uint64_t> v; v.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) v.push_back(rng());
+
+    auto start = std::chrono::steady_clock::now();
+    distributed_vergesort(v, transport);
+    auto end = std::chrono::steady_clock::now();
+
+    if (!std::is_sorted(v.begin(), v.end())) {
+        std::cerr << "rank " << rank << ": slice is not sorted\n";
+        return 1;
+    }
+
+    // Every rank checks that its first element is not lower than the
+    // last element of the previous rank
+    std::uint64_t last = v.empty() ? 0 : v.back();
+    std::vector<char> received;
+    transport.exchange((rank + 1) % size, &last, v.empty() ? 0 : sizeof last,
+                       (rank - 1 + size) % size, received);
+    if (rank > 0 && !received.empty() && !v.empty()) {
+        std::uint64_t previous_last;
+        std::memcpy(&previous_last, &received[0], sizeof previous_last);
+        if (v.front() < previous_last) {
+            std::cerr << "rank " << rank << ": slices overlap\n";
+            return 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "rank " << rank << " " << v.size() << " elements "
+              << seconds * 1000 << " ms " << count / seconds / 1e6 << " Melem/s\n";
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int size = argc > 1 ? std::atoi(argv[1]) : 4;
+    std::size_t count = argc > 2 ? std::strtoull(argv[2], 0, 10) : 1000000;
+
+    char directory[] = "/tmp/vergesort-XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+
+    std::vector<pid_t> children;
+    for (int rank = 0; rank < size; ++rank) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int status = 1;
+            try {
+                status = run_rank(directory, rank, size, count);
+            } catch (const std::exception& e) {
+                std::cerr << "rank " << rank << ": " << e.what() << "\n";
+            }
+            std::exit(status);
+        }
+        children.push_back(pid);
+    }
+
+    int failures = 0;
+    for (pid_t pid : children) {
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failures;
+    }
+    rmdir(directory);
+
+    std::cout << (failures ? "FAILED" : "OK") << "\n";
+    return failures != 0;
+}
@@ -0,0 +1,113 @@
+#ifndef BENCH_DISTRIBUTIONS_H_
+#define BENCH_DISTRIBUTIONS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+inline std::vector<int> shuffled_int(size_t size, std::mt19937_64& rng) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 0; i < size; ++i) v.push_back(i);
+    std::shuffle(v.begin(), v.end(), rng);
+    return v;
+}
+
+inline std::vector<int> shuffled_16_values_int(size_t size, std::mt19937_64& rng) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 0; i < size; ++i) v.push_back(i % 16);
+    std::shuffle(v.begin(), v.end(), rng);
+    return v;
+}
+
+inline std::vector<int> all_equal_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 0; i < size; ++i) v.push_back(0);
+    return v;
+}
+
+inline std::vector<int> ascending_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 0; i < size; ++i) v.push_back(i);
+    return v;
+}
+
+inline std::vector<int> descending_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = size; i-- > 0;) v.push_back(i);
+    return v;
+}
+
+inline std::vector<int> pipe_organ_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 0; i < size/2; ++i) v.push_back(i);
+    for (size_t i = size/2; i < size; ++i) v.push_back(size - i);
+    return v;
+}
+
+inline std::vector<int> push_front_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 1; i < size; ++i) v.push_back(i);
+    v.push_back(0);
+    return v;
+}
+
+inline std::vector<int> push_middle_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        if (i != size/2) v.push_back(i);
+    }
+    v.push_back(size/2);
+    return v;
+}
+
+inline std::vector<int> ascending_sawtooth_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    size_t limit = size / log2(size) * 1.1;
+    for (size_t i = 0; i < size; ++i) v.push_back(i % limit);
+    return v;
+}
+
+inline std::vector<int> descending_sawtooth_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    size_t limit = size / log2(size) * 1.1;
+    for (size_t i = size; i-- > 0;) v.push_back(i % limit);
+    return v;
+}
+
+inline std::vector<int> alternating_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 0; i < size; ++i) v.push_back(i);
+    for (size_t i = 0; i < size; i += 2) v[i] *= -1;
+    return v;
+}
+
+inline std::vector<int> alternating_16_values_int(size_t size, std::mt19937_64&) {
+    std::vector<int> v; v.reserve(size);
+    for (size_t i = 0; i < size; ++i) v.push_back(i % 16);
+    for (size_t i = 0; i < size; i += 2) v[i] *= -1;
+    return v;
+}
+
+typedef std::vector<int> (*DistrF)(size_t, std::mt19937_64&);
+
+// Every distribution, with the name the benchmarks give it in their output
+const std::pair<std::string, DistrF> distributions[] = {
+    {"shuffled", shuffled_int},
+    {"shuffled_16_values", shuffled_16_values_int},
+    {"all_equal", all_equal_int},
+    {"ascending", ascending_int},
+    {"descending", descending_int},
+    {"pipe_organ", pipe_organ_int},
+    {"push_front", push_front_int},
+    {"push_middle", push_middle_int},
+    {"ascending_sawtooth", ascending_sawtooth_int},
+    {"descending_sawtooth", descending_sawtooth_int},
+    {"alternating", alternating_int},
+    {"alternating_16_values", alternating_16_values_int}
+};
+
+#endif // BENCH_DISTRIBUTIONS_H_
@@ -0,0 +1,91 @@
+// Throughput of vergesort, pdqsort and std::sort on collections too big
+// to be indexed with 32-bit integers. The default size of 2^32 uint32_t
+// values needs 16 GiB of memory; the base 2 logarithm of the size can be
+// given as the first argument to run smaller experiments.
+//
+// Output: one "size distribution algorithm seconds elements_per_second"
+// line per measure.
+//
+// Build: g++ -std=c++14 -O2 -march=native large.cpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../pdqsort.h"
+#include "../vergesort.h"
+
+
+// The generators fill an existing collection: there is only ever one
+// collection of that size in memory.
+void shuffled(std::vector<uint32_t>& v, std::mt19937_64& rng) {
+    for (size_t i = 0; i < v.size(); ++i) v[i] = uint32_t(rng());
+}
+
+void ascending(std::vector<uint32_t>& v, std::mt19937_64&) {
+    for (size_t i = 0; i < v.size(); ++i) v[i] = uint32_t(i);
+}
+
+void descending(std::vector<uint32_t>& v, std::mt19937_64&) {
+    for (size_t i = 0; i < v.size(); ++i) v[i] = uint32_t(v.size() - 1 - i);
+}
+
+// Runs a bit bigger than n / log n, the size above which vergesort
+// merges them instead of falling back to pdqsort
+void ascending_sawtooth(std::vector<uint32_t>& v, std::mt19937_64&) {
+    size_t limit = v.size() / pdqsort_detail::log2(v.size()) * 1.1;
+    for (size_t i = 0; i < v.size(); ++i) v[i] = uint32_t(i % limit);
+}
+
+int main(int argc, char** argv) {
+    int log_size = argc > 1 ? std::atoi(argv[1]) : 32;
+    size_t size = size_t(1) << log_size;
+
+    typedef void (*DistrF)(std::vector<uint32_t>&, std::mt19937_64&);
+    typedef std::vector<uint32_t>::iterator Iter;
+    typedef void (*SortF)(Iter, Iter, std::less<uint32_t>);
+
+    std::pair<std::string, DistrF> distributions[] = {
+        {"shuffled_uint32", shuffled},
+        {"ascending_uint32", ascending},
+        {"descending_uint32", descending},
+        {"ascending_sawtooth_uint32", ascending_sawtooth}
+    };
+
+    std::pair<std::string, SortF> sorts[] = {
+        {"introsort", &std::sort<Iter, std::less<uint32_t>>},
+        {"pdqsort", &pdqsort<Iter, std::less<uint32_t>>},
+        {"vergesort", &vergesort<Iter, std::less<uint32_t>>}
+    };
+
+    std::mt19937_64 el;
+    std::vector<uint32_t> v(size);
+
+    for (auto& distribution : distributions) {
+        for (auto& sort : sorts) {
+            el.seed(0);
+            distribution.second(v, el);
+
+            auto start = std::chrono::steady_clock::now();
+            sort.second(v.begin(), v.end(), std::less<uint32_t>());
+            auto end = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(end - start).count();
+
+            if (!std::is_sorted(v.begin(), v.end())) {
+                std::cerr << distribution.first << " " << sort.first << ": not sorted\n";
+                return 1;
+            }
+
+            std::cerr << size << " " << distribution.first << " " << sort.first << "\n";
+            std::cout << size << " " << distribution.first << " " << sort.first << " "
+                      << seconds << " " << size / seconds << "\n";
+        }
+    }
+}
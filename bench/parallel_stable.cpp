@@ -0,0 +1,102 @@
+// Compares parallel_stable_vergesort to std::stable_sort, sequential and
+// with the parallel execution policy. Same output format as bench.cpp.
+//
+// Build: g++ -std=c++17 -O2 -march=native parallel_stable.cpp -pthread [-ltbb]
+
+#include <random>
+#include <ctime>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <utility>
+#include <functional>
+#include <string>
+#include <thread>
+
+#if __has_include(<execution>)
+    #include <execution>
+#endif
+
+#include "../parallel_vergesort.h"
+#include "distributions.h"
+#include "rdtsc.h"
+
+
+template<class Iter, class Compare>
+void std_stable_sort(Iter begin, Iter end, Compare comp) {
+    std::stable_sort(begin, end, comp);
+}
+
+#if defined(__cpp_lib_execution) && __cpp_lib_execution >= 201603L
+template<class Iter, class Compare>
+void std_stable_sort_par(Iter begin, Iter end, Compare comp) {
+    std::stable_sort(std::execution::par, begin, end, comp);
+}
+#endif
+
+template<class Iter, class Compare>
+void stable_vergesort(Iter begin, Iter end, Compare comp) {
+    parallel_stable_vergesort(begin, end, comp, 1);
+}
+
+template<class Iter, class Compare>
+void stable_vergesort_par(Iter begin, Iter end, Compare comp) {
+    parallel_stable_vergesort(begin, end, comp);
+}
+
+template<class Iter, class Compare>
+void vergesort_par(Iter begin, Iter end, Compare comp) {
+    parallel_vergesort(begin, end, comp);
+}
+
+
+int main() {
+    auto seed = std::time(0);
+    std::mt19937_64 el;
+
+    typedef void (*SortF)(std::vector<int>::iterator, std::vector<int>::iterator, std::less<int>);
+    typedef std::vector<int>::iterator Iter;
+
+    std::pair<std::string, SortF> sorts[] = {
+        {"std_stable_sort", &std_stable_sort<Iter, std::less<int>>},
+#if defined(__cpp_lib_execution) && __cpp_lib_execution >= 201603L
+        {"std_stable_sort_par", &std_stable_sort_par<Iter, std::less<int>>},
+#endif
+        {"stable_vergesort", &stable_vergesort<Iter, std::less<int>>},
+        {"parallel_stable_vergesort", &stable_vergesort_par<Iter, std::less<int>>},
+        {"parallel_vergesort", &vergesort_par<Iter, std::less<int>>}
+    };
+
+    std::cerr << std::thread::hardware_concurrency() << " hardware threads\n";
+
+    int sizes[] = {10000000};
+
+    for (auto& distribution : distributions) {
+        for (auto& sort : sorts) {
+            el.seed(seed);
+
+            for (auto size : sizes) {
+                std::chrono::time_point<std::chrono::high_resolution_clock> total_start, total_end;
+                std::vector<uint64_t> cycles;
+
+                total_start = std::chrono::high_resolution_clock::now();
+                total_end = std::chrono::high_resolution_clock::now();
+                while (std::chrono::duration_cast<std::chrono::milliseconds>(total_end - total_start).count() < 10000) {
+                    std::vector<int> v = distribution.second(size, el);
+                    uint64_t start = rdtsc();
+                    sort.second(v.begin(), v.end(), std::less<int>());
+                    uint64_t end = rdtsc();
+                    cycles.push_back(double(end - start) / size + 0.5);
+                    total_end = std::chrono::high_resolution_clock::now();
+                }
+
+                std::sort(cycles.begin(), cycles.end());
+
+                std::cerr << size << " " << distribution.first << "_int " << sort.first << "\n";
+                std::cout << size << " " << distribution.first << "_int " << sort.first << " ";
+                for (uint64_t cycle : cycles) std::cout << cycle << " ";
+                std::cout << "\n";
+            }
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef BENCH_RDTSC_H_
+#define BENCH_RDTSC_H_
+
+#ifdef _WIN32
+    #include <intrin.h>
+    #define rdtsc __rdtsc
+#else
+    #ifdef __i386__
+        static __inline__ unsigned long long rdtsc() {
+            unsigned long long int x;
+            __asm__ volatile(".byte 0x0f, 0x31" : "=A" (x));
+            return x;
+        }
+    #elif defined(__x86_64__)
+        static __inline__ unsigned long long rdtsc(){
+            unsigned hi, lo;
+            __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+            return ((unsigned long long) lo) | (((unsigned long long) hi) << 32);
+        }
+    #else
+        #error no rdtsc implementation
+    #endif
+#endif
+
+#endif // BENCH_RDTSC_H_
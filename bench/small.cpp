@@ -0,0 +1,100 @@
+// Cost of a single call to a sort for tiny collections, in nanoseconds.
+// Every call sorts a copy of one of many shuffled inputs that stay in the
+// L1 cache; the cost of the copies and of the loop is measured on its own
+// and subtracted, so that what remains is the cost of the call itself:
+// dispatch, setup and the actual sorting.
+//
+// Output: one "size algorithm ns_per_call" line per measure.
+//
+// Build: g++ -std=c++14 -O2 -march=native small.cpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../pdqsort.h"
+#include "../vergesort.h"
+
+
+template<class Iter, class Compare>
+void baseline(Iter, Iter, Compare) {
+}
+
+template<class Iter, class Compare>
+void insertion_sort(Iter begin, Iter end, Compare comp) {
+    pdqsort_detail::insertion_sort(begin, end, comp);
+}
+
+// Keeps the compiler from optimizing the sorts away.
+volatile int sink;
+
+typedef void (*SortF)(int*, int*, std::less<int>);
+
+// Nanoseconds taken by repeat rounds over all the inputs.
+double measure(SortF sort, std::vector<int>& inputs, std::size_t size, std::size_t repeat) {
+    std::size_t count = inputs.size() / size;
+    std::vector<int> work(size);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0; r < repeat; ++r) {
+        for (std::size_t i = 0; i < count; ++i) {
+            std::memcpy(work.data(), inputs.data() + i * size, size * sizeof(int));
+            sort(work.data(), work.data() + size, std::less<int>());
+            sink = work[size / 2];
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+int main() {
+    std::mt19937_64 el(std::random_device{}());
+
+    std::pair<std::string, SortF> sorts[] = {
+        {"insertion_sort", &insertion_sort<int*, std::less<int>>},
+        {"std_sort", &std::sort<int*, std::less<int>>},
+        {"pdqsort", &pdqsort<int*, std::less<int>>},
+        {"vergesort", &vergesort<int*, std::less<int>>}
+    };
+
+    std::size_t sizes[] = {
+        1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 28, 32, 40, 48, 64,
+        79, 80, 96, 128, 192, 256, 384, 500, 750, 1000
+    };
+
+    // About 16 KiB of inputs, and about 5 million sorted elements per measure
+    const std::size_t input_elements = 4096;
+    const std::size_t sorted_elements = 5000000;
+
+    for (auto size : sizes) {
+        std::size_t count = std::max<std::size_t>(input_elements / size, 1);
+        std::vector<int> inputs(count * size);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::iota(inputs.begin() + i * size, inputs.begin() + (i + 1) * size, 0);
+            std::shuffle(inputs.begin() + i * size, inputs.begin() + (i + 1) * size, el);
+        }
+        std::size_t repeat = std::max<std::size_t>(sorted_elements / inputs.size(), 1);
+        double calls = double(repeat) * count;
+
+        // Best of a few runs, to get rid of the noise
+        auto best = [&](SortF sort) {
+            double result = measure(sort, inputs, size, repeat);
+            for (int run = 0; run < 4; ++run) result = std::min(result, measure(sort, inputs, size, repeat));
+            return result;
+        };
+
+        double overhead = best(&baseline<int*, std::less<int>>);
+        for (auto& sort : sorts) {
+            double ns = (best(sort.second) - overhead) / calls;
+            std::cerr << size << " " << sort.first << "\n";
+            std::cout << size << " " << sort.first << " " << ns << "\n";
+        }
+    }
+}
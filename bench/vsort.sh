@@ -0,0 +1,57 @@
+#!/bin/sh
+# Throughput of tools/vsort compared to GNU sort on the same inputs.
+#
+# Usage: bench/vsort.sh [lines]
+#
+# Both tools compare bytes (LC_ALL=C) and get the same thread count and
+# memory budget; outputs are checked to be identical.
+
+set -e
+
+lines=${1:-10000000}
+threads=$(nproc)
+here=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+export LC_ALL=C
+
+${CXX:-g++} -std=c++11 -O2 -march=native -pthread "$here/../tools/vsort.cpp" -o "$work/vsort"
+
+seq "$lines" | shuf --random-source=/dev/zero > "$work/shuffled"
+seq "$lines" > "$work/ascending"
+sort -r "$work/ascending" > "$work/descending"
+awk 'NR % 100 == 0 { print int(rand() * 1000000); next } { print }' "$work/ascending" > "$work/almost_sorted"
+awk '{ print $1 % 1000 "\tfield\t" $1 }' "$work/shuffled" > "$work/fields"
+
+now() {
+    date +%s.%N
+}
+
+run() {
+    name=$1; input=$2; shift 2
+    bytes=$(wc -c < "$input")
+
+    start=$(now)
+    sort --parallel="$threads" -S 1G "$@" "$input" > "$work/gnu.out"
+    gnu=$(awk "BEGIN { print $(now) - $start }")
+
+    start=$(now)
+    "$work/vsort" --parallel="$threads" -S 1G "$@" "$input" > "$work/vsort.out"
+    verge=$(awk "BEGIN { print $(now) - $start }")
+
+    cmp -s "$work/gnu.out" "$work/vsort.out" || echo "$name: outputs differ" >&2
+    awk -v name="$name" -v bytes="$bytes" -v gnu="$gnu" -v verge="$verge" 'BEGIN {
+        printf "%-28s gnu %8.1f MB/s   vsort %8.1f MB/s\n", name, bytes / gnu / 1e6, bytes / verge / 1e6
+    }'
+}
+
+run "shuffled" "$work/shuffled"
+run "shuffled -n" "$work/shuffled" -n
+run "ascending" "$work/ascending"
+run "descending -n" "$work/descending" -n
+run "almost sorted -n" "$work/almost_sorted" -n
+run "fields -k1,1 -n" "$work/fields" -k1,1 -n
+run "fields -k1,1 -n -u" "$work/fields" -k1,1 -n -u
+run "shuffled -r" "$work/shuffled" -r
+run "shuffled -S 64M (spill)" "$work/shuffled" -S 64M
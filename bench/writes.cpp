@@ -0,0 +1,86 @@
+// Number of element writes of several sorts, for storage where writes are
+// much more expensive than reads. The elements count every copy or move
+// assignment and construction they are the target of, which includes the
+// writes to scratch buffers and temporaries.
+//
+// Output: one "size distribution algorithm writes_per_element cycles_per_element"
+// line per measure.
+//
+// Build: g++ -std=c++14 -O2 -march=native writes.cpp
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../pdqsort.h"
+#include "../vergesort.h"
+#include "../vergesort_writes.h"
+#include "distributions.h"
+#include "rdtsc.h"
+
+
+struct counted {
+    static std::size_t writes;
+    int value;
+
+    counted(int value = 0) : value(value) {}
+    counted(const counted& other) : value(other.value) { ++writes; }
+    counted& operator=(const counted& other) { value = other.value; ++writes; return *this; }
+
+    friend bool operator<(const counted& lhs, const counted& rhs) { return lhs.value < rhs.value; }
+};
+
+std::size_t counted::writes = 0;
+
+typedef std::vector<counted>::iterator Iter;
+
+template<class Iter, class Compare>
+void min_writes(Iter begin, Iter end, Compare comp) {
+    vergesort_min_writes(begin, end, comp);
+}
+
+template<class Iter, class Compare>
+void std_stable_sort(Iter begin, Iter end, Compare comp) {
+    std::stable_sort(begin, end, comp);
+}
+
+int main() {
+    auto seed = std::time(0);
+    std::mt19937_64 el;
+
+    typedef void (*SortF)(Iter, Iter, std::less<counted>);
+
+    std::pair<std::string, SortF> sorts[] = {
+        {"introsort", &std::sort<Iter, std::less<counted>>},
+        {"std_stable_sort", &std_stable_sort<Iter, std::less<counted>>},
+        {"pdqsort", &pdqsort<Iter, std::less<counted>>},
+        {"vergesort", &vergesort<Iter, std::less<counted>>},
+        {"vergesort_min_writes", &min_writes<Iter, std::less<counted>>}
+    };
+
+    size_t size = 1000000;
+
+    for (auto& distribution : distributions) {
+        for (auto& sort : sorts) {
+            el.seed(seed);
+            std::vector<int> input = distribution.second(size, el);
+            std::vector<counted> v(input.begin(), input.end());
+
+            counted::writes = 0;
+            uint64_t start = rdtsc();
+            sort.second(v.begin(), v.end(), std::less<counted>());
+            uint64_t end = rdtsc();
+
+            std::cerr << size << " " << distribution.first << "_int " << sort.first << "\n";
+            std::cout << size << " " << distribution.first << "_int " << sort.first << " "
+                      << double(counted::writes) / size << " " << (end - start) / size << "\n";
+        }
+    }
+}
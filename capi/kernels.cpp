@@ -0,0 +1,169 @@
+/*
+ * kernels.cpp - vergesort instantiations for one instruction set
+ *
+ * This file is compiled once per instruction set with VERGESORT_ISA set
+ * to its name and the matching code generation flags. It must also be
+ * compiled with -fno-weak so that every template instantiation stays
+ * local to its object file: otherwise the linker would be free to pick
+ * an AVX-512 copy of a shared template for the generic entry points.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+#include "../vergesort.h"
+
+#ifndef VERGESORT_ISA
+    #error VERGESORT_ISA must name the instruction set this file is compiled for
+#endif
+
+#define VERGESORT_ISA_NAME2(name, isa) name##_##isa
+#define VERGESORT_ISA_NAME1(name, isa) VERGESORT_ISA_NAME2(name, isa)
+#define VERGESORT_ISA_NAME(name) VERGESORT_ISA_NAME1(name, VERGESORT_ISA)
+
+namespace
+{
+    // Orders NaNs after every other value
+    template<typename T>
+    struct nan_last_less
+    {
+        bool operator()(T lhs, T rhs) const
+        {
+            return lhs < rhs || (rhs != rhs && lhs == lhs);
+        }
+    };
+
+    template<typename T>
+    struct key_compare
+    {
+        typedef std::less<T> type;
+    };
+
+    template<>
+    struct key_compare<float>
+    {
+        typedef nan_last_less<float> type;
+    };
+
+    template<>
+    struct key_compare<double>
+    {
+        typedef nan_last_less<double> type;
+    };
+
+    template<typename T>
+    struct pair_compare
+    {
+        typename key_compare<T>::type compare;
+
+        bool operator()(const std::pair<T, std::uint64_t>& lhs,
+                        const std::pair<T, std::uint64_t>& rhs) const
+        {
+            return compare(lhs.first, rhs.first);
+        }
+    };
+
+    // Ties are broken by index to make the sort stable
+    template<typename T>
+    struct index_compare
+    {
+        const T* keys;
+        typename key_compare<T>::type compare;
+
+        bool operator()(std::size_t lhs, std::size_t rhs) const
+        {
+            if (compare(keys[lhs], keys[rhs])) return true;
+            if (compare(keys[rhs], keys[lhs])) return false;
+            return lhs < rhs;
+        }
+    };
+
+    template<typename T>
+    void sort_keys(T* keys, std::size_t size)
+    {
+        vergesort(keys, keys + size, typename key_compare<T>::type());
+    }
+
+    template<typename T>
+    int sort_key_values(T* keys, std::uint64_t* values, std::size_t size)
+    {
+        std::vector<std::pair<T, std::uint64_t> > pairs;
+        try
+        {
+            pairs.reserve(size);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return -1;
+        }
+
+        for (std::size_t i = 0 ; i < size ; ++i)
+        {
+            pairs.push_back(std::make_pair(keys[i], values[i]));
+        }
+        vergesort(pairs.begin(), pairs.end(), pair_compare<T>());
+        for (std::size_t i = 0 ; i < size ; ++i)
+        {
+            keys[i] = pairs[i].first;
+            values[i] = pairs[i].second;
+        }
+        return 0;
+    }
+
+    template<typename T>
+    void argsort_keys(const T* keys, std::size_t* indices, std::size_t size)
+    {
+        for (std::size_t i = 0 ; i < size ; ++i) indices[i] = i;
+        index_compare<T> compare = { keys };
+        vergesort(indices, indices + size, compare);
+    }
+}
+
+#define VERGESORT_KERNELS_DEFINE(suffix, type)                                              \
+    extern "C" void VERGESORT_ISA_NAME(vergesort_##suffix)(type* keys, std::size_t size)    \
+    {                                                                                       \
+        sort_keys(keys, size);                                                              \
+    }                                                                                       \
+    extern "C" int VERGESORT_ISA_NAME(vergesort_kv_##suffix)(type* keys,                    \
+                                                             std::uint64_t* values,         \
+                                                             std::size_t size)              \
+    {                                                                                       \
+        return sort_key_values(keys, values, size);                                         \
+    }                                                                                       \
+    extern "C" void VERGESORT_ISA_NAME(vergesort_argsort_##suffix)(const type* keys,        \
+                                                                   std::size_t* indices,    \
+                                                                   std::size_t size)        \
+    {                                                                                       \
+        argsort_keys(keys, indices, size);                                                  \
+    }
+
+VERGESORT_KERNELS_DEFINE(i32, std::int32_t)
+VERGESORT_KERNELS_DEFINE(i64, std::int64_t)
+VERGESORT_KERNELS_DEFINE(u32, std::uint32_t)
+VERGESORT_KERNELS_DEFINE(u64, std::uint64_t)
+VERGESORT_KERNELS_DEFINE(f32, float)
+VERGESORT_KERNELS_DEFINE(f64, double)
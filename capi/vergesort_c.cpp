@@ -0,0 +1,122 @@
+/*
+ * vergesort_c.cpp - Load-time selection of the vergesort kernels
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <cstddef>
+#include <cstdint>
+#include "vergesort_c.h"
+
+// VERGESORT_X86_CLONES is defined by the Makefile when kernels.cpp has
+// also been compiled for AVX2 and AVX-512; the entry points are then GNU
+// indirect functions whose resolver runs once, when the library is loaded
+#if defined(VERGESORT_X86_CLONES) && defined(__GNUC__) && defined(__ELF__) \
+    && (defined(__x86_64__) || defined(__i386__))
+    #define VERGESORT_USE_IFUNC
+#endif
+
+namespace
+{
+    enum isa
+    {
+        isa_generic,
+        isa_avx2,
+        isa_avx512
+    };
+
+    isa detect_isa()
+    {
+#ifdef VERGESORT_USE_IFUNC
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl"))
+        {
+            return isa_avx512;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return isa_avx2;
+        }
+#endif
+        return isa_generic;
+    }
+}
+
+#ifdef VERGESORT_USE_IFUNC
+
+#define VERGESORT_C_DISPATCH1(name, ret, params, args)                          \
+    extern "C" ret name##_generic params;                                       \
+    extern "C" ret name##_avx2 params;                                          \
+    extern "C" ret name##_avx512 params;                                        \
+    extern "C" {                                                                \
+        typedef ret (*name##_function) params;                                  \
+        static name##_function resolve_##name()                                 \
+        {                                                                       \
+            switch (detect_isa())                                               \
+            {                                                                   \
+                case isa_avx512: return name##_avx512;                          \
+                case isa_avx2:   return name##_avx2;                            \
+                default:         return name##_generic;                         \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+    extern "C" ret name params __attribute__((ifunc("resolve_" #name)));
+
+#else
+
+#define VERGESORT_C_DISPATCH1(name, ret, params, args)                          \
+    extern "C" ret name##_generic params;                                       \
+    extern "C" ret name params                                                  \
+    {                                                                           \
+        return name##_generic args;                                             \
+    }
+
+#endif
+
+#define VERGESORT_C_DISPATCH(suffix, type)                                                  \
+    VERGESORT_C_DISPATCH1(vergesort_##suffix, void,                                         \
+                          (type* keys, std::size_t size),                                   \
+                          (keys, size))                                                     \
+    VERGESORT_C_DISPATCH1(vergesort_kv_##suffix, int,                                       \
+                          (type* keys, std::uint64_t* values, std::size_t size),            \
+                          (keys, values, size))                                             \
+    VERGESORT_C_DISPATCH1(vergesort_argsort_##suffix, void,                                 \
+                          (const type* keys, std::size_t* indices, std::size_t size),       \
+                          (keys, indices, size))
+
+VERGESORT_C_DISPATCH(i32, std::int32_t)
+VERGESORT_C_DISPATCH(i64, std::int64_t)
+VERGESORT_C_DISPATCH(u32, std::uint32_t)
+VERGESORT_C_DISPATCH(u64, std::uint64_t)
+VERGESORT_C_DISPATCH(f32, float)
+VERGESORT_C_DISPATCH(f64, double)
+
+extern "C" const char* vergesort_isa(void)
+{
+    switch (detect_isa())
+    {
+        case isa_avx512: return "avx512";
+        case isa_avx2:   return "avx2";
+        default:         return "generic";
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * vergesort_c.h - C interface to the precompiled vergesort library
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_C_H_
+#define VERGESORT_C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Every function comes in six flavours: i32, i64, u32, u64, f32 and f64.
+ * Floating point keys are sorted with NaNs last.
+ *
+ * vergesort_<t>(keys, size)
+ *     Sort keys in place.
+ *
+ * vergesort_kv_<t>(keys, values, size)
+ *     Sort keys in place, applying the same permutation to values.
+ *     Returns 0 on success, -1 if the scratch buffer could not be
+ *     allocated, in which case both arrays are left untouched.
+ *
+ * vergesort_argsort_<t>(keys, indices, size)
+ *     Write into indices the positions that would stably sort keys,
+ *     keys are left untouched.
+ */
+#define VERGESORT_C_DECLARE(suffix, type)                                               \
+    void vergesort_##suffix(type* keys, size_t size);                                   \
+    int vergesort_kv_##suffix(type* keys, uint64_t* values, size_t size);               \
+    void vergesort_argsort_##suffix(const type* keys, size_t* indices, size_t size);
+
+VERGESORT_C_DECLARE(i32, int32_t)
+VERGESORT_C_DECLARE(i64, int64_t)
+VERGESORT_C_DECLARE(u32, uint32_t)
+VERGESORT_C_DECLARE(u64, uint64_t)
+VERGESORT_C_DECLARE(f32, float)
+VERGESORT_C_DECLARE(f64, double)
+
+#undef VERGESORT_C_DECLARE
+
+/* Name of the instruction set the library selected at load time:
+   "avx512", "avx2" or "generic" */
+const char* vergesort_isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VERGESORT_C_H_ */
@@ -0,0 +1,188 @@
+/*
+ * distributed_vergesort.h - Sample sort across processes built on vergesort
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef DISTRIBUTED_VERGESORT_H_
+#define DISTRIBUTED_VERGESORT_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "vergesort.h"
+#include "vergesort_merge.h"
+
+// Point-to-point communication between the ranks taking part in a
+// distributed sort. Every rank must call exchange the same number of
+// times and in the same order as its peers
+class verge_transport
+{
+    public:
+
+        virtual ~verge_transport() {}
+
+        // Identifier of this process, in [0, size())
+        virtual int rank() const = 0;
+
+        // Number of processes taking part in the sort
+        virtual int size() const = 0;
+
+        // Send bytes to rank to while receiving the message that rank
+        // from sends to this process; both transfers must progress at
+        // the same time or big messages would deadlock
+        virtual void exchange(int to, const void* data, std::size_t bytes,
+                              int from, std::vector<char>& received) = 0;
+};
+
+namespace vergesort_detail
+{
+    enum {
+        // Number of samples taken by every rank for each rank
+        distributed_oversampling = 32
+    };
+
+    template<typename T>
+    void append_bytes(std::vector<T>& out, const std::vector<char>& bytes)
+    {
+        std::size_t old_size = out.size();
+        std::size_t count = bytes.size() / sizeof(T);
+        if (count == 0) return;
+        out.resize(old_size + count);
+        std::memcpy(&out[old_size], &bytes[0], count * sizeof(T));
+    }
+
+    // Every rank ends up with the concatenation of everyone's values,
+    // ordered by rank
+    template<typename T>
+    std::vector<T> allgather(const std::vector<T>& values, verge_transport& transport)
+    {
+        int rank = transport.rank();
+        int size = transport.size();
+
+        std::vector<std::vector<char> > pieces(size);
+        pieces[rank].resize(values.size() * sizeof(T));
+        if (not values.empty())
+        {
+            std::memcpy(&pieces[rank][0], &values[0], pieces[rank].size());
+        }
+        for (int step = 1 ; step < size ; ++step)
+        {
+            int to = (rank + step) % size;
+            int from = (rank - step + size) % size;
+            transport.exchange(to, values.empty() ? 0 : &values[0], values.size() * sizeof(T),
+                               from, pieces[from]);
+        }
+
+        std::vector<T> result;
+        for (int i = 0 ; i < size ; ++i)
+        {
+            append_bytes(result, pieces[i]);
+        }
+        return result;
+    }
+}
+
+// Sort data across every rank of transport: once it returns, data holds
+// this rank's slice of the global order, and every element on rank i
+// compares lower than or equal to every element on rank i + 1. Slices
+// are balanced by sampling but their sizes may differ, in particular
+// when many elements are equivalent
+template<typename T, typename Compare>
+void distributed_vergesort(std::vector<T>& data, verge_transport& transport, Compare compare)
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "distributed_vergesort sends elements as raw bytes");
+
+    int rank = transport.rank();
+    int size = transport.size();
+
+    vergesort(data.begin(), data.end(), compare);
+    if (size < 2) return;
+
+    // Regular sampling of the locally sorted data
+    std::vector<T> samples;
+    std::size_t nb_samples = std::min<std::size_t>(
+        data.size(), vergesort_detail::distributed_oversampling * size
+    );
+    for (std::size_t i = 0 ; i < nb_samples ; ++i)
+    {
+        samples.push_back(data[(2 * i + 1) * data.size() / (2 * nb_samples)]);
+    }
+
+    // Every rank gets the same samples and deterministically computes
+    // the same splitters; the samples are made of size sorted runs,
+    // which vergesort handles well
+    std::vector<T> all_samples = vergesort_detail::allgather(samples, transport);
+    vergesort(all_samples.begin(), all_samples.end(), compare);
+    std::vector<T> splitters;
+    for (int i = 1 ; i < size ; ++i)
+    {
+        if (all_samples.empty()) break;
+        splitters.push_back(all_samples[i * all_samples.size() / size]);
+    }
+
+    // Bucket i is the contiguous range of local data that belongs to rank i
+    std::vector<std::size_t> bucket_bounds(size + 1, data.size());
+    bucket_bounds[0] = 0;
+    for (std::size_t i = 0 ; i < splitters.size() ; ++i)
+    {
+        bucket_bounds[i + 1] = std::upper_bound(data.begin() + bucket_bounds[i], data.end(),
+                                                splitters[i], compare) - data.begin();
+    }
+
+    // All-to-all exchange, shifting the destination by one rank per step;
+    // pieces[i] is the sorted piece received from rank i
+    std::vector<std::vector<T> > pieces(size);
+    pieces[rank].assign(data.begin() + bucket_bounds[rank], data.begin() + bucket_bounds[rank + 1]);
+    std::vector<char> received;
+    for (int step = 1 ; step < size ; ++step)
+    {
+        int to = (rank + step) % size;
+        int from = (rank - step + size) % size;
+        std::size_t count = bucket_bounds[to + 1] - bucket_bounds[to];
+        transport.exchange(to, count ? &data[bucket_bounds[to]] : 0, count * sizeof(T),
+                           from, received);
+        vergesort_detail::append_bytes(pieces[from], received);
+    }
+
+    // k-way merge of the pieces with a loser tree, on a single thread
+    // since the ranks may share the machine
+    std::size_t total = 0;
+    for (int i = 0 ; i < size ; ++i)
+    {
+        total += pieces[i].size();
+    }
+    data.resize(total);
+    vergesort_merge_k(pieces, data.begin(), compare, 1);
+}
+
+template<typename T>
+void distributed_vergesort(std::vector<T>& data, verge_transport& transport)
+{
+    distributed_vergesort(data, transport, std::less<T>());
+}
+
+#endif // DISTRIBUTED_VERGESORT_H_
@@ -0,0 +1,629 @@
+/*
+ * parallel_vergesort.h - Multithreaded vergesort
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef PARALLEL_VERGESORT_H_
+#define PARALLEL_VERGESORT_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "vergesort.h"
+
+namespace vergesort_detail
+{
+    enum {
+        // Below this number of elements per thread, the cost of
+        // spawning threads outweighs the gains
+        parallel_grain_size = 1 << 15
+    };
+
+    // Number of threads to use when the caller does not say
+    inline unsigned default_thread_count()
+    {
+        unsigned threads = std::thread::hardware_concurrency();
+        return threads ? threads : 1;
+    }
+
+    // Merge two adjacent sorted ranges, skipping the merge entirely
+    // when they are already in order, which is common when the
+    // original collection had runs spanning several chunks
+    template<typename RandomAccessIterator, typename Compare>
+    void merge_adjacent(RandomAccessIterator first, RandomAccessIterator middle,
+                        RandomAccessIterator last, Compare compare)
+    {
+        if (first == middle || middle == last) return;
+        if (not compare(*middle, *(middle - 1))) return;
+        std::inplace_merge(first, middle, last, compare);
+    }
+
+    // Sort every chunk delimited by bounds concurrently, then merge
+    // neighbouring chunks pairwise, one round of merges at a time
+    template<typename RandomAccessIterator, typename Compare, typename ChunkSort>
+    void parallel_sort_chunks(std::vector<RandomAccessIterator> bounds,
+                              Compare compare, ChunkSort chunk_sort)
+    {
+        std::vector<std::thread> workers;
+        for (std::size_t i = 1 ; i + 1 < bounds.size() ; ++i)
+        {
+            workers.emplace_back(chunk_sort, bounds[i], bounds[i+1]);
+        }
+        chunk_sort(bounds[0], bounds[1]);
+        for (std::thread& worker: workers) worker.join();
+
+        while (bounds.size() > 2)
+        {
+            workers.clear();
+            std::vector<RandomAccessIterator> merged;
+            merged.push_back(bounds[0]);
+            for (std::size_t i = 0 ; i + 2 < bounds.size() ; i += 2)
+            {
+                workers.emplace_back(
+                    merge_adjacent<RandomAccessIterator, Compare>,
+                    bounds[i], bounds[i+1], bounds[i+2], compare
+                );
+                merged.push_back(bounds[i+2]);
+            }
+            // Odd chunk out, carried over to the next round
+            if (bounds.size() % 2 == 0)
+            {
+                merged.push_back(bounds.back());
+            }
+            for (std::thread& worker: workers) worker.join();
+            bounds.swap(merged);
+        }
+    }
+
+    // Split [first, last) into at most threads chunks of roughly
+    // equal size, never smaller than the parallel grain size
+    template<typename RandomAccessIterator>
+    std::vector<RandomAccessIterator> split_chunks(RandomAccessIterator first,
+                                                   RandomAccessIterator last,
+                                                   unsigned threads)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+        difference_type dist = std::distance(first, last);
+
+        difference_type max_chunks = dist / parallel_grain_size;
+        difference_type chunks = std::min<difference_type>(threads, max_chunks);
+        if (chunks < 1) chunks = 1;
+
+        std::vector<RandomAccessIterator> bounds;
+        bounds.reserve(chunks + 1);
+        for (difference_type i = 0 ; i < chunks ; ++i)
+        {
+            bounds.push_back(first + dist / chunks * i + std::min(i, dist % chunks));
+        }
+        bounds.push_back(last);
+        return bounds;
+    }
+
+    template<typename RandomAccessIterator, typename Compare>
+    struct vergesort_chunk
+    {
+        Compare compare;
+
+        void operator()(RandomAccessIterator first, RandomAccessIterator last) const
+        {
+            ::vergesort(first, last, compare);
+        }
+    };
+
+    // Empty list able to exchange nodes with the given one
+    template<typename List>
+    List empty_list_like(const List&)
+    {
+        return List();
+    }
+
+    template<typename T, typename Allocator>
+    std::list<T, Allocator> empty_list_like(const std::list<T, Allocator>& list)
+    {
+        return std::list<T, Allocator>(list.get_allocator());
+    }
+
+    // Merge from into into by relinking nodes; when the lists are
+    // already in order, from is simply appended
+    template<typename List, typename Compare>
+    void merge_lists(List* into, List* from, Compare compare)
+    {
+        if (into->empty() || from->empty() ||
+            not compare(*from->begin(), *std::prev(into->end())))
+        {
+            into->splice(into->end(), *from);
+            return;
+        }
+        into->merge(*from, compare);
+    }
+
+    // Whether a list is better sorted by moving its values than by
+    // relinking its nodes: relinking scatters the nodes in memory, which
+    // makes the sort several times slower when values are cheap to move
+    template<typename T>
+    struct is_list_value_sortable:
+        std::integral_constant<
+            bool,
+            std::is_nothrow_move_constructible<T>::value &&
+            std::is_nothrow_move_assignable<T>::value &&
+            sizeof(T) <= 4 * sizeof(void*)
+        >
+    {};
+
+    template<typename List, typename Compare>
+    void sort_list(List& list, Compare compare, std::true_type)
+    {
+        ::vergesort(list.begin(), list.end(), compare);
+    }
+
+    // Sorts a list by relinking its nodes, values are never moved: the
+    // natural runs are detached one node at a time, strictly descending
+    // ones being reversed on the way, and merged as they come into bins
+    // holding about 2^k runs each, as std::list::sort does
+    template<typename List, typename Compare>
+    void sort_list(List& list, Compare compare, std::false_type)
+    {
+        std::vector<List> bins;
+        List run = empty_list_like(list);
+        while (not list.empty())
+        {
+            run.splice(run.end(), list, list.begin());
+            if (not list.empty() && compare(*list.begin(), *run.begin()))
+            {
+                do
+                {
+                    run.splice(run.begin(), list, list.begin());
+                } while (not list.empty() && compare(*list.begin(), *run.begin()));
+            }
+            else
+            {
+                while (not list.empty() && not compare(*list.begin(), *std::prev(run.end())))
+                {
+                    run.splice(run.end(), list, list.begin());
+                }
+            }
+
+            // The bins hold older nodes than the run, which keeps the
+            // merges stable
+            std::size_t k = 0;
+            for (; k < bins.size() && not bins[k].empty() ; ++k)
+            {
+                merge_lists(&bins[k], &run, compare);
+                run.swap(bins[k]);
+            }
+            if (k == bins.size()) bins.push_back(empty_list_like(list));
+            run.swap(bins[k]);
+        }
+
+        for (std::size_t k = 0 ; k < bins.size() ; ++k)
+        {
+            merge_lists(&bins[k], &run, compare);
+            run.swap(bins[k]);
+        }
+        list.swap(run);
+    }
+
+    template<typename List, typename Compare>
+    void sort_list(List& list, Compare compare)
+    {
+        typedef typename List::value_type value_type;
+        sort_list(list, compare, is_list_value_sortable<value_type>());
+    }
+
+    template<typename List, typename Compare>
+    struct list_sort_chunk
+    {
+        Compare compare;
+
+        void operator()(List* list) const
+        {
+            sort_list(*list, compare);
+        }
+    };
+
+    enum {
+        // Runs shorter than this are extended with an insertion sort
+        // by the stable sort
+        stable_min_run = 32
+    };
+
+    // Stable natural mergesort: ascending runs are kept, strictly
+    // descending ones are reversed, short ones are extended with an
+    // insertion sort, then runs are merged pairwise in place
+    template<typename RandomAccessIterator, typename Compare>
+    void stable_vergesort(RandomAccessIterator first, RandomAccessIterator last, Compare compare)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+
+        std::vector<RandomAccessIterator> bounds;
+        bounds.push_back(first);
+        RandomAccessIterator begin_run = first;
+        while (begin_run != last)
+        {
+            RandomAccessIterator end_run = begin_run + 1;
+            if (end_run != last && compare(*end_run, *begin_run))
+            {
+                // Only strictly descending runs can be reversed
+                // without breaking stability
+                while (end_run != last && compare(*end_run, *(end_run - 1))) ++end_run;
+                std::reverse(begin_run, end_run);
+            }
+            else
+            {
+                while (end_run != last && not compare(*end_run, *(end_run - 1))) ++end_run;
+            }
+
+            if (end_run - begin_run < stable_min_run)
+            {
+                end_run = begin_run + std::min<difference_type>(stable_min_run, last - begin_run);
+                pdqsort_detail::insertion_sort(begin_run, end_run, compare);
+            }
+            bounds.push_back(end_run);
+            begin_run = end_run;
+        }
+
+        while (bounds.size() > 2)
+        {
+            std::vector<RandomAccessIterator> merged;
+            merged.push_back(bounds[0]);
+            for (std::size_t i = 0 ; i + 2 < bounds.size() ; i += 2)
+            {
+                merge_adjacent(bounds[i], bounds[i+1], bounds[i+2], compare);
+                merged.push_back(bounds[i+2]);
+            }
+            if (bounds.size() % 2 == 0)
+            {
+                merged.push_back(bounds.back());
+            }
+            bounds.swap(merged);
+        }
+    }
+
+    template<typename RandomAccessIterator, typename Compare>
+    struct stable_vergesort_chunk
+    {
+        Compare compare;
+
+        void operator()(RandomAccessIterator first, RandomAccessIterator last) const
+        {
+            stable_vergesort(first, last, compare);
+        }
+    };
+
+    // Number of elements of [first1, last1) among the first diagonal
+    // elements of the stable merge of [first1, last1) and [first2, last2):
+    // on ties, elements of the first range come first
+    template<typename RandomAccessIterator, typename Compare>
+    std::size_t merge_path_split(RandomAccessIterator first1, RandomAccessIterator last1,
+                                 RandomAccessIterator first2, RandomAccessIterator last2,
+                                 std::size_t diagonal, Compare compare)
+    {
+        std::size_t size1 = last1 - first1;
+        std::size_t size2 = last2 - first2;
+        std::size_t low = diagonal > size2 ? diagonal - size2 : 0;
+        std::size_t high = std::min(diagonal, size1);
+        while (low < high)
+        {
+            std::size_t i = low + (high - low) / 2;
+            std::size_t j = diagonal - i;
+            if (j > 0 && not compare(first2[j - 1], first1[i]))
+            {
+                low = i + 1;
+            }
+            else
+            {
+                high = i;
+            }
+        }
+        return low;
+    }
+
+    // Move-merge the slice [begin, end) of the output of the stable merge
+    // of [first1, last1) and [first2, last2) into out + begin
+    template<typename InputIterator, typename OutputIterator, typename Compare>
+    void merge_path_slice(InputIterator first1, InputIterator last1,
+                          InputIterator first2, InputIterator last2,
+                          OutputIterator out, std::size_t begin, std::size_t end,
+                          Compare compare)
+    {
+        std::size_t i1 = merge_path_split(first1, last1, first2, last2, begin, compare);
+        std::size_t i2 = merge_path_split(first1, last1, first2, last2, end, compare);
+        std::merge(std::make_move_iterator(first1 + i1),
+                   std::make_move_iterator(first1 + i2),
+                   std::make_move_iterator(first2 + (begin - i1)),
+                   std::make_move_iterator(first2 + (end - i2)),
+                   out + begin, compare);
+    }
+
+    template<typename InputIterator, typename OutputIterator>
+    void move_slice(InputIterator first, InputIterator last, OutputIterator out)
+    {
+        std::move(first, last, out);
+    }
+
+    // Sort the chunks delimited by bounds concurrently, then merge them
+    // pairwise into a buffer and back. Every round of merges keeps all
+    // threads busy: each merge is cut along its merge path into as many
+    // slices as there are threads for it, and slices are merged
+    // independently into disjoint parts of the destination
+    template<typename RandomAccessIterator, typename Compare, typename ChunkSort>
+    void parallel_merge_chunks(std::vector<RandomAccessIterator> bounds, unsigned threads,
+                               Compare compare, ChunkSort chunk_sort)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+        typedef typename std::vector<value_type>::iterator buffer_iterator;
+
+        std::vector<std::thread> workers;
+        for (std::size_t i = 1 ; i + 1 < bounds.size() ; ++i)
+        {
+            workers.emplace_back(chunk_sort, bounds[i], bounds[i+1]);
+        }
+        chunk_sort(bounds[0], bounds[1]);
+        for (std::thread& worker: workers) worker.join();
+
+        RandomAccessIterator first = bounds.front();
+        RandomAccessIterator last = bounds.back();
+        std::vector<value_type> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+
+        std::vector<std::size_t> offsets;
+        for (std::size_t i = 0 ; i < bounds.size() ; ++i)
+        {
+            offsets.push_back(bounds[i] - first);
+        }
+
+        // Ping-pong between the buffer and the original collection
+        bool in_buffer = true;
+        while (offsets.size() > 2)
+        {
+            std::size_t nb_merges = (offsets.size() - 1) / 2;
+            std::size_t slices_per_merge = std::max<std::size_t>(1, threads / nb_merges);
+
+            workers.clear();
+            std::vector<std::size_t> merged;
+            merged.push_back(0);
+            for (std::size_t i = 0 ; i + 2 < offsets.size() ; i += 2)
+            {
+                std::size_t begin = offsets[i];
+                std::size_t middle = offsets[i+1];
+                std::size_t end = offsets[i+2];
+                for (std::size_t s = 0 ; s < slices_per_merge ; ++s)
+                {
+                    std::size_t slice_begin = (end - begin) * s / slices_per_merge;
+                    std::size_t slice_end = (end - begin) * (s + 1) / slices_per_merge;
+                    if (in_buffer)
+                    {
+                        workers.emplace_back(
+                            merge_path_slice<buffer_iterator, RandomAccessIterator, Compare>,
+                            buffer.begin() + begin, buffer.begin() + middle,
+                            buffer.begin() + middle, buffer.begin() + end,
+                            first + begin, slice_begin, slice_end, compare
+                        );
+                    }
+                    else
+                    {
+                        workers.emplace_back(
+                            merge_path_slice<RandomAccessIterator, buffer_iterator, Compare>,
+                            first + begin, first + middle,
+                            first + middle, first + end,
+                            buffer.begin() + begin, slice_begin, slice_end, compare
+                        );
+                    }
+                }
+                merged.push_back(end);
+            }
+            // Odd chunk out, moved as is to the destination
+            if (offsets.size() % 2 == 0)
+            {
+                std::size_t begin = offsets[offsets.size() - 2];
+                std::size_t end = offsets.back();
+                if (in_buffer)
+                {
+                    workers.emplace_back(move_slice<buffer_iterator, RandomAccessIterator>,
+                                         buffer.begin() + begin, buffer.begin() + end, first + begin);
+                }
+                else
+                {
+                    workers.emplace_back(move_slice<RandomAccessIterator, buffer_iterator>,
+                                         first + begin, first + end, buffer.begin() + begin);
+                }
+                merged.push_back(end);
+            }
+            for (std::thread& worker: workers) worker.join();
+            offsets.swap(merged);
+            in_buffer = not in_buffer;
+        }
+
+        if (in_buffer)
+        {
+            workers.clear();
+            std::size_t size = buffer.size();
+            for (unsigned t = 1 ; t < threads ; ++t)
+            {
+                workers.emplace_back(move_slice<buffer_iterator, RandomAccessIterator>,
+                                     buffer.begin() + size * t / threads,
+                                     buffer.begin() + size * (t + 1) / threads,
+                                     first + size * t / threads);
+            }
+            std::move(buffer.begin(), buffer.begin() + size / threads, first);
+            for (std::thread& worker: workers) worker.join();
+        }
+    }
+}
+
+template<typename RandomAccessIterator, typename Compare>
+void parallel_vergesort(RandomAccessIterator first, RandomAccessIterator last,
+                        Compare compare, unsigned threads)
+{
+    std::vector<RandomAccessIterator> bounds = vergesort_detail::split_chunks(first, last, threads);
+    if (bounds.size() <= 2)
+    {
+        vergesort(first, last, compare);
+        return;
+    }
+
+    // Bail out early when the whole collection is already sorted: the
+    // sequential scan is cheaper than running it once per chunk
+    if (vergesort_detail::is_sorted_until(first, last, compare) == last) return;
+
+    vergesort_detail::vergesort_chunk<RandomAccessIterator, Compare> chunk_sort = { compare };
+    vergesort_detail::parallel_sort_chunks(bounds, compare, chunk_sort);
+}
+
+template<typename RandomAccessIterator, typename Compare>
+void parallel_vergesort(RandomAccessIterator first, RandomAccessIterator last, Compare compare)
+{
+    parallel_vergesort(first, last, compare, vergesort_detail::default_thread_count());
+}
+
+template<typename RandomAccessIterator>
+void parallel_vergesort(RandomAccessIterator first, RandomAccessIterator last)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+    parallel_vergesort(first, last, std::less<value_type>());
+}
+
+// Stable counterpart of parallel_vergesort: chunks are sorted with a
+// stable natural mergesort, then merged in parallel along merge paths.
+// Needs a buffer of the size of the collection
+template<typename RandomAccessIterator, typename Compare>
+void parallel_stable_vergesort(RandomAccessIterator first, RandomAccessIterator last,
+                               Compare compare, unsigned threads)
+{
+    std::vector<RandomAccessIterator> bounds = vergesort_detail::split_chunks(first, last, threads);
+    if (bounds.size() <= 2)
+    {
+        vergesort_detail::stable_vergesort(first, last, compare);
+        return;
+    }
+
+    if (vergesort_detail::is_sorted_until(first, last, compare) == last) return;
+
+    vergesort_detail::stable_vergesort_chunk<RandomAccessIterator, Compare> chunk_sort = { compare };
+    vergesort_detail::parallel_merge_chunks(bounds, threads, compare, chunk_sort);
+}
+
+template<typename RandomAccessIterator, typename Compare>
+void parallel_stable_vergesort(RandomAccessIterator first, RandomAccessIterator last, Compare compare)
+{
+    parallel_stable_vergesort(first, last, compare, vergesort_detail::default_thread_count());
+}
+
+template<typename RandomAccessIterator>
+void parallel_stable_vergesort(RandomAccessIterator first, RandomAccessIterator last)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+    parallel_stable_vergesort(first, last, std::less<value_type>());
+}
+
+// Parallel vergesort for std::list and list types with the same splice
+// and merge interface: the list is cut into segments in a single walk,
+// the segments are sorted concurrently, then merged back pairwise in
+// parallel rounds; only nodes are relinked, values are never moved
+template<typename List, typename Compare>
+void parallel_list_vergesort(List& list, Compare compare, unsigned threads)
+{
+    std::size_t size = list.size();
+    std::size_t chunks = std::min<std::size_t>(threads, size / vergesort_detail::parallel_grain_size);
+    if (chunks < 2)
+    {
+        vergesort_detail::sort_list(list, compare);
+        return;
+    }
+
+    // Nodes are handed to the segments one at a time: splicing a range
+    // between lists counts its nodes again to update the sizes. The same
+    // walk checks whether the list is already sorted
+    std::vector<List> segments;
+    segments.reserve(chunks);
+    bool sorted = true;
+    for (std::size_t i = 0 ; i < chunks ; ++i)
+    {
+        segments.push_back(vergesort_detail::empty_list_like(list));
+        std::size_t length = size / chunks + (i < size % chunks);
+        for (std::size_t j = 0 ; j < length ; ++j)
+        {
+            if (sorted && (i || j) && compare(*list.begin(), *std::prev(segments[i - not j].end())))
+            {
+                sorted = false;
+            }
+            segments[i].splice(segments[i].end(), list, list.begin());
+        }
+    }
+    if (sorted)
+    {
+        for (std::size_t i = 0 ; i < chunks ; ++i) list.splice(list.end(), segments[i]);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    vergesort_detail::list_sort_chunk<List, Compare> chunk_sort = { compare };
+    for (std::size_t i = 1 ; i < segments.size() ; ++i)
+    {
+        workers.emplace_back(chunk_sort, &segments[i]);
+    }
+    chunk_sort(&segments[0]);
+    for (std::thread& worker: workers) worker.join();
+
+    while (segments.size() > 1)
+    {
+        workers.clear();
+        for (std::size_t i = 0 ; i + 1 < segments.size() ; i += 2)
+        {
+            workers.emplace_back(
+                vergesort_detail::merge_lists<List, Compare>,
+                &segments[i], &segments[i+1], compare
+            );
+        }
+        for (std::thread& worker: workers) worker.join();
+
+        // Keep the merged lists and the odd one out
+        std::vector<List> merged;
+        merged.reserve(segments.size() / 2 + 1);
+        for (std::size_t i = 0 ; i < segments.size() ; i += 2)
+        {
+            merged.push_back(std::move(segments[i]));
+        }
+        segments.swap(merged);
+    }
+    list.splice(list.end(), segments[0]);
+}
+
+template<typename List, typename Compare>
+void parallel_list_vergesort(List& list, Compare compare)
+{
+    parallel_list_vergesort(list, compare, vergesort_detail::default_thread_count());
+}
+
+template<typename List>
+void parallel_list_vergesort(List& list)
+{
+    typedef typename List::value_type value_type;
+    parallel_list_vergesort(list, std::less<value_type>());
+}
+
+#endif // PARALLEL_VERGESORT_H_
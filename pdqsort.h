@@ -105,9 +105,10 @@ namespace pdqsort_detail {
     template<class Iter, class Compare>
     inline bool partial_insertion_sort(Iter begin, Iter end, Compare comp) {
         typedef typename std::iterator_traits<Iter>::value_type T;
+        typedef typename std::iterator_traits<Iter>::difference_type difference_type;
         if (begin == end) return true;
 
-        int limit = 0;
+        difference_type limit = 0;
         for (Iter cur = begin + 1; cur != end; ++cur) {
             if (limit > partial_insertion_sort_limit) return false;
 
@@ -132,9 +133,10 @@ namespace pdqsort_detail {
     template<class Iter, class Compare>
     inline bool unguarded_partial_insertion_sort(Iter begin, Iter end, Compare comp) {
         typedef typename std::iterator_traits<Iter>::value_type T;
+        typedef typename std::iterator_traits<Iter>::difference_type difference_type;
         if (begin == end) return true;
 
-        int limit = 0;
+        difference_type limit = 0;
         for (Iter cur = begin + 1; cur != end; ++cur) {
             if (limit > partial_insertion_sort_limit) return false;
 
@@ -0,0 +1,301 @@
+/*
+ * _vergesort.cpp - Python bindings for vergesort
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "parallel_vergesort.h"
+#include "vergesort.h"
+
+namespace
+{
+    // Orders NaNs after every other value, like numpy.sort does
+    template<typename T>
+    struct nan_last_less
+    {
+        bool operator()(T lhs, T rhs) const
+        {
+            return lhs < rhs || (rhs != rhs && lhs == lhs);
+        }
+    };
+
+    template<typename T>
+    struct key_compare
+    {
+        typedef std::less<T> type;
+    };
+
+    template<>
+    struct key_compare<float>
+    {
+        typedef nan_last_less<float> type;
+    };
+
+    template<>
+    struct key_compare<double>
+    {
+        typedef nan_last_less<double> type;
+    };
+
+    // Compares indices through the keys they refer to; ties are broken
+    // by index so that argsort is stable and deterministic
+    template<typename T>
+    struct index_compare
+    {
+        const T* keys;
+        typename key_compare<T>::type compare;
+
+        bool operator()(std::int64_t lhs, std::int64_t rhs) const
+        {
+            if (compare(keys[lhs], keys[rhs])) return true;
+            if (compare(keys[rhs], keys[lhs])) return false;
+            return lhs < rhs;
+        }
+    };
+
+    template<typename T>
+    void sort_keys(void* data, Py_ssize_t size, unsigned threads)
+    {
+        T* first = static_cast<T*>(data);
+        typename key_compare<T>::type compare;
+        if (threads > 1)
+        {
+            parallel_vergesort(first, first + size, compare, threads);
+        }
+        else
+        {
+            vergesort(first, first + size, compare);
+        }
+    }
+
+    template<typename T>
+    void argsort_keys(void* data, std::int64_t* indices, Py_ssize_t size, unsigned threads)
+    {
+        for (Py_ssize_t i = 0 ; i < size ; ++i) indices[i] = i;
+        index_compare<T> compare = { static_cast<const T*>(data) };
+        if (threads > 1)
+        {
+            parallel_vergesort(indices, indices + size, compare, threads);
+        }
+        else
+        {
+            vergesort(indices, indices + size, compare);
+        }
+    }
+
+    enum key_type
+    {
+        key_unsupported,
+        key_int8, key_int16, key_int32, key_int64,
+        key_uint8, key_uint16, key_uint32, key_uint64,
+        key_float32, key_float64
+    };
+
+    // Map a buffer protocol format string and item size to a key type,
+    // only native byte order is supported
+    key_type buffer_key_type(const Py_buffer& view)
+    {
+        const char* format = view.format ? view.format : "B";
+        if (*format == '@' || *format == '=' || *format == '<' || *format == '>' || *format == '!')
+        {
+            bool big_endian = (*format == '>' || *format == '!');
+            const std::uint16_t probe = 1;
+            bool native_big_endian = *reinterpret_cast<const unsigned char*>(&probe) == 0;
+            if (big_endian != native_big_endian && *format != '@' && *format != '=')
+            {
+                return key_unsupported;
+            }
+            ++format;
+        }
+        if (format[0] == '\0' || format[1] != '\0') return key_unsupported;
+
+        switch (format[0])
+        {
+            case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+                switch (view.itemsize)
+                {
+                    case 1: return key_int8;
+                    case 2: return key_int16;
+                    case 4: return key_int32;
+                    case 8: return key_int64;
+                }
+                break;
+            case '?': case 'B': case 'H': case 'I': case 'L': case 'Q': case 'N':
+                switch (view.itemsize)
+                {
+                    case 1: return key_uint8;
+                    case 2: return key_uint16;
+                    case 4: return key_uint32;
+                    case 8: return key_uint64;
+                }
+                break;
+            case 'f':
+                if (view.itemsize == 4) return key_float32;
+                break;
+            case 'd':
+                if (view.itemsize == 8) return key_float64;
+                break;
+        }
+        return key_unsupported;
+    }
+
+    bool get_keys(PyObject* obj, Py_buffer& view, key_type& type, int flags)
+    {
+        if (PyObject_GetBuffer(obj, &view, flags | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) != 0)
+        {
+            return false;
+        }
+        if (view.ndim > 1)
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "only one-dimensional arrays can be sorted");
+            return false;
+        }
+        type = buffer_key_type(view);
+        if (type == key_unsupported)
+        {
+            PyErr_Format(PyExc_TypeError, "unsupported element format '%s'",
+                         view.format ? view.format : "B");
+            PyBuffer_Release(&view);
+            return false;
+        }
+        return true;
+    }
+
+    PyObject* py_sort(PyObject*, PyObject* args, PyObject* kwargs)
+    {
+        static const char* keywords[] = { "keys", "threads", NULL };
+        PyObject* obj;
+        unsigned threads = 1;
+        if (not PyArg_ParseTupleAndKeywords(args, kwargs, "O|I:sort",
+                                            const_cast<char**>(keywords), &obj, &threads))
+        {
+            return NULL;
+        }
+
+        Py_buffer view;
+        key_type type;
+        if (not get_keys(obj, view, type, PyBUF_WRITABLE)) return NULL;
+        Py_ssize_t size = view.len / view.itemsize;
+
+        Py_BEGIN_ALLOW_THREADS
+        switch (type)
+        {
+            case key_int8:    sort_keys<std::int8_t>(view.buf, size, threads);   break;
+            case key_int16:   sort_keys<std::int16_t>(view.buf, size, threads);  break;
+            case key_int32:   sort_keys<std::int32_t>(view.buf, size, threads);  break;
+            case key_int64:   sort_keys<std::int64_t>(view.buf, size, threads);  break;
+            case key_uint8:   sort_keys<std::uint8_t>(view.buf, size, threads);  break;
+            case key_uint16:  sort_keys<std::uint16_t>(view.buf, size, threads); break;
+            case key_uint32:  sort_keys<std::uint32_t>(view.buf, size, threads); break;
+            case key_uint64:  sort_keys<std::uint64_t>(view.buf, size, threads); break;
+            case key_float32: sort_keys<float>(view.buf, size, threads);         break;
+            case key_float64: sort_keys<double>(view.buf, size, threads);        break;
+            case key_unsupported: break;
+        }
+        Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&view);
+        Py_RETURN_NONE;
+    }
+
+    PyObject* py_argsort(PyObject*, PyObject* args, PyObject* kwargs)
+    {
+        static const char* keywords[] = { "keys", "out", "threads", NULL };
+        PyObject* obj;
+        PyObject* out_obj;
+        unsigned threads = 1;
+        if (not PyArg_ParseTupleAndKeywords(args, kwargs, "OO|I:argsort",
+                                            const_cast<char**>(keywords), &obj, &out_obj, &threads))
+        {
+            return NULL;
+        }
+
+        Py_buffer view;
+        key_type type;
+        if (not get_keys(obj, view, type, PyBUF_SIMPLE)) return NULL;
+        Py_ssize_t size = view.len / view.itemsize;
+
+        Py_buffer out;
+        key_type out_type;
+        if (not get_keys(out_obj, out, out_type, PyBUF_WRITABLE))
+        {
+            PyBuffer_Release(&view);
+            return NULL;
+        }
+        if (out_type != key_int64 || out.len / out.itemsize != size)
+        {
+            PyBuffer_Release(&out);
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "out must be an int64 array of the same length as keys");
+            return NULL;
+        }
+        std::int64_t* indices = static_cast<std::int64_t*>(out.buf);
+
+        Py_BEGIN_ALLOW_THREADS
+        switch (type)
+        {
+            case key_int8:    argsort_keys<std::int8_t>(view.buf, indices, size, threads);   break;
+            case key_int16:   argsort_keys<std::int16_t>(view.buf, indices, size, threads);  break;
+            case key_int32:   argsort_keys<std::int32_t>(view.buf, indices, size, threads);  break;
+            case key_int64:   argsort_keys<std::int64_t>(view.buf, indices, size, threads);  break;
+            case key_uint8:   argsort_keys<std::uint8_t>(view.buf, indices, size, threads);  break;
+            case key_uint16:  argsort_keys<std::uint16_t>(view.buf, indices, size, threads); break;
+            case key_uint32:  argsort_keys<std::uint32_t>(view.buf, indices, size, threads); break;
+            case key_uint64:  argsort_keys<std::uint64_t>(view.buf, indices, size, threads); break;
+            case key_float32: argsort_keys<float>(view.buf, indices, size, threads);         break;
+            case key_float64: argsort_keys<double>(view.buf, indices, size, threads);        break;
+            case key_unsupported: break;
+        }
+        Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&out);
+        PyBuffer_Release(&view);
+        Py_RETURN_NONE;
+    }
+
+    PyMethodDef methods[] = {
+        { "sort", reinterpret_cast<PyCFunction>(py_sort), METH_VARARGS | METH_KEYWORDS,
+          "sort(keys, threads=1)\n\nSort a writable one-dimensional buffer in place." },
+        { "argsort", reinterpret_cast<PyCFunction>(py_argsort), METH_VARARGS | METH_KEYWORDS,
+          "argsort(keys, out, threads=1)\n\nWrite into the int64 buffer out the indices "
+          "that would stably sort keys." },
+        { NULL, NULL, 0, NULL }
+    };
+
+    PyModuleDef module = {
+        PyModuleDef_HEAD_INIT, "_vergesort",
+        "Vergesort over objects supporting the buffer protocol.",
+        -1, methods, NULL, NULL, NULL, NULL
+    };
+}
+
+PyMODINIT_FUNC PyInit__vergesort()
+{
+    return PyModule_Create(&module);
+}
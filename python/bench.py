@@ -0,0 +1,103 @@
+import math
+import sys
+import time
+
+import numpy
+
+import vergesort
+
+
+def shuffled_int(size, rng):
+    return rng.permutation(size).astype(numpy.int32)
+
+def shuffled_16_values_int(size, rng):
+    return rng.permutation(numpy.arange(size, dtype=numpy.int32) % 16)
+
+def all_equal_int(size, rng):
+    return numpy.zeros(size, dtype=numpy.int32)
+
+def ascending_int(size, rng):
+    return numpy.arange(size, dtype=numpy.int32)
+
+def descending_int(size, rng):
+    return numpy.arange(size - 1, -1, -1, dtype=numpy.int32)
+
+def pipe_organ_int(size, rng):
+    half = size // 2
+    return numpy.concatenate((numpy.arange(half), size - numpy.arange(half, size))).astype(numpy.int32)
+
+def push_front_int(size, rng):
+    return numpy.append(numpy.arange(1, size), 0).astype(numpy.int32)
+
+def push_middle_int(size, rng):
+    v = numpy.arange(size, dtype=numpy.int32)
+    return numpy.append(numpy.delete(v, size // 2), size // 2).astype(numpy.int32)
+
+def ascending_sawtooth_int(size, rng):
+    limit = int(size / math.log2(size) * 1.1)
+    return (numpy.arange(size) % limit).astype(numpy.int32)
+
+def descending_sawtooth_int(size, rng):
+    limit = int(size / math.log2(size) * 1.1)
+    return (numpy.arange(size - 1, -1, -1) % limit).astype(numpy.int32)
+
+def alternating_int(size, rng):
+    v = numpy.arange(size, dtype=numpy.int32)
+    v[::2] *= -1
+    return v
+
+def alternating_16_values_int(size, rng):
+    v = (numpy.arange(size) % 16).astype(numpy.int32)
+    v[::2] *= -1
+    return v
+
+
+distributions = [
+    shuffled_int,
+    shuffled_16_values_int,
+    all_equal_int,
+    ascending_int,
+    descending_int,
+    pipe_organ_int,
+    push_front_int,
+    push_middle_int,
+    ascending_sawtooth_int,
+    descending_sawtooth_int,
+    alternating_int,
+    alternating_16_values_int,
+]
+
+sorts = [
+    ("numpy_quicksort", lambda a: a.sort(kind="quicksort")),
+    ("numpy_stable", lambda a: a.sort(kind="stable")),
+    ("numpy_heapsort", lambda a: a.sort(kind="heapsort")),
+    ("vergesort", lambda a: vergesort.sort(a)),
+    ("parallel_vergesort", lambda a: vergesort.sort(a, parallel=True)),
+    ("numpy_argsort", lambda a: a.argsort(kind="stable")),
+    ("vergesort_argsort", lambda a: vergesort.argsort(a)),
+]
+
+
+def main():
+    size = int(sys.argv[1]) if len(sys.argv) > 1 else 10**6
+    dtypes = [numpy.int32, numpy.int64, numpy.uint32, numpy.float64]
+    for dtype in dtypes:
+        for distribution in distributions:
+            for name, sort in sorts:
+                rng = numpy.random.default_rng(0)
+                timings = []
+                total_start = time.perf_counter()
+                while time.perf_counter() - total_start < 2:
+                    v = distribution(size, rng).astype(dtype)
+                    start = time.perf_counter_ns()
+                    sort(v)
+                    end = time.perf_counter_ns()
+                    timings.append((end - start) / size)
+                timings.sort()
+                label = "{}_{}".format(distribution.__name__, numpy.dtype(dtype).name)
+                print(size, label, name, " ".join("{:.2f}".format(t) for t in timings))
+                sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
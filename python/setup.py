@@ -0,0 +1,21 @@
+import os
+
+from setuptools import Extension, setup
+
+root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+setup(
+    name="vergesort",
+    version="0.1",
+    packages=["vergesort"],
+    ext_modules=[
+        Extension(
+            "vergesort._vergesort",
+            ["_vergesort.cpp"],
+            include_dirs=[root],
+            extra_compile_args=["-std=c++11", "-O2"],
+            extra_link_args=["-pthread"],
+            language="c++",
+        )
+    ],
+)
@@ -0,0 +1,38 @@
+"""Vergesort for NumPy arrays and other objects supporting the buffer protocol.
+
+Arrays are sorted in place without any copy, the GIL is released while
+sorting. Supported element types are int8 to int64, uint8 to uint64,
+float32 and float64 in native byte order; NaNs are sorted last.
+"""
+
+import os
+
+from ._vergesort import argsort as _argsort
+from ._vergesort import sort as _sort
+
+__all__ = ["sort", "argsort"]
+
+
+def _threads(parallel):
+    if parallel is True:
+        return os.cpu_count() or 1
+    if not parallel:
+        return 1
+    return int(parallel)
+
+
+def sort(a, parallel=False):
+    """Sort the contiguous one-dimensional array a in place.
+
+    parallel may be True to use every CPU, or a number of threads.
+    """
+    _sort(a, _threads(parallel))
+
+
+def argsort(a, parallel=False):
+    """Return the indices that would stably sort a, as an int64 array."""
+    import numpy
+
+    out = numpy.empty(len(a), dtype=numpy.int64)
+    _argsort(a, out, _threads(parallel))
+    return out
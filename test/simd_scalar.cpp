@@ -0,0 +1,124 @@
+// Checks the scalar backend of vergesort_simd.h, which is forced below,
+// against plain loops: every operation of ops<T> for every supported type,
+// the vectorized sorted-prefix scan with the first descent at every position
+// and vergesort itself. The scalar backend is only used by default on targets
+// without SIMD flags, where the kernels are disabled, so it is not exercised
+// by any other build.
+//
+// Output: the failed checks, if any; exits with 1 when a check failed.
+//
+// Build: g++ -std=c++11 -O2 simd_scalar.cpp && ./a.out
+
+#define VERGESORT_SIMD_SCALAR
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../vergesort.h"
+
+
+namespace simd = vergesort_detail::simd;
+
+int failures = 0;
+
+void check(bool condition, const char* type, const char* what) {
+    if (!condition) {
+        std::cout << type << ": " << what << " failed\n";
+        ++failures;
+    }
+}
+
+template<class T>
+void check_ops(const char* type, std::mt19937_64& rng) {
+    typedef simd::ops<T> ops;
+    const std::size_t width = ops::width;
+
+    for (int round = 0; round < 1000; ++round) {
+        // Few distinct values so that equal lanes are common
+        T a[16], b[16], out[16];
+        for (std::size_t i = 0; i < width; ++i) {
+            a[i] = T(rng() % 8);
+            b[i] = T(rng() % 8);
+        }
+
+        unsigned less = 0, equal = 0;
+        for (std::size_t i = 0; i < width; ++i) {
+            less |= unsigned(a[i] < b[i]) << i;
+            equal |= unsigned(a[i] == b[i]) << i;
+        }
+        check(ops::less(ops::load(a), ops::load(b)) == less, type, "less");
+        check(ops::equal(ops::load(a), ops::load(b)) == equal, type, "equal");
+
+        ops::store(out, ops::load(a));
+        check(std::equal(a, a + width, out), type, "load/store");
+
+        ops::store(out, ops::broadcast(b[0]));
+        check(std::count(out, out + width, b[0]) == std::ptrdiff_t(width), type, "broadcast");
+
+        ops::store(out, ops::min(ops::load(a), ops::load(b)));
+        for (std::size_t i = 0; i < width; ++i) check(out[i] == std::min(a[i], b[i]), type, "min");
+
+        ops::store(out, ops::max(ops::load(a), ops::load(b)));
+        for (std::size_t i = 0; i < width; ++i) check(out[i] == std::max(a[i], b[i]), type, "max");
+    }
+}
+
+template<class T>
+void check_scan(const char* type, std::mt19937_64& rng) {
+    for (std::size_t size = 0; size < 100; ++size) {
+        std::vector<T> v(size);
+        for (std::size_t i = 0; i < size; ++i) v[i] = T(i + 1);
+
+        // Pointers and vector iterators with std::less take the kernel
+        check(vergesort_detail::scan_sorted_until(v.begin(), v.end(), std::less<T>()) == v.end(),
+              type, "scan of sorted data");
+        for (std::size_t pos = 1; pos < size; ++pos) {
+            std::vector<T> w = v;
+            w[pos] = w[pos - 1];
+            check(vergesort_detail::scan_sorted_until(w.data(), w.data() + size, std::less<T>())
+                      == w.data() + size, type, "scan with equal neighbours");
+            w[pos] = T(0);
+            check(vergesort_detail::scan_sorted_until(w.begin(), w.end(), std::less<T>())
+                      == w.begin() + pos, type, "scan with a descent");
+        }
+    }
+
+    for (std::size_t size : {10, 1000, 100000}) {
+        std::vector<T> v(size);
+        for (std::size_t i = 0; i < size; ++i) v[i] = T(i < size / 2 ? i : rng() % size);
+        std::vector<T> expected = v;
+        std::sort(expected.begin(), expected.end());
+        vergesort(v.begin(), v.end());
+        check(v == expected, type, "vergesort");
+    }
+}
+
+template<class T>
+void check_type(const char* type, std::mt19937_64& rng) {
+    check(simd::is_supported<T>::value, type, "is_supported");
+    check(vergesort_detail::is_simd_scannable<typename std::vector<T>::iterator, std::less<T>>::value,
+          type, "is_simd_scannable");
+    check_ops<T>(type, rng);
+    check_scan<T>(type, rng);
+}
+
+int main() {
+    std::mt19937_64 rng(0);
+
+    // Forcing the scalar backend enables it, unlike falling back to it
+    check(simd::enabled, "all", "enabled");
+
+    check_type<int32_t>("int32", rng);
+    check_type<uint32_t>("uint32", rng);
+    check_type<int64_t>("int64", rng);
+    check_type<uint64_t>("uint64", rng);
+    check_type<float>("float", rng);
+    check_type<double>("double", rng);
+
+    return failures == 0 ? 0 : 1;
+}
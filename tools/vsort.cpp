@@ -0,0 +1,877 @@
+/*
+ * vsort.cpp - Sort lines of text or fixed-width records with vergesort
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Build: g++ -std=c++11 -O2 vsort.cpp -pthread -o vsort
+//
+// Text is compared byte by byte, like GNU sort with LC_ALL=C. Inputs that
+// do not fit in the memory budget given by -S are sorted by chunks which
+// are spilled to temporary files, then merged.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "../parallel_vergesort.h"
+#include "../vergesort.h"
+
+namespace
+{
+    struct options
+    {
+        // Key: fields (text) or bytes (binary), 1-based and inclusive,
+        // key_last == 0 meaning up to the end of the record
+        std::size_t key_first = 0;
+        std::size_t key_last = 0;
+        int separator = -1;
+        bool numeric = false;
+        bool reverse = false;
+        bool unique = false;
+        std::size_t record_size = 0;
+        std::size_t memory = std::size_t(1) << 30;
+        unsigned threads = 1;
+        std::string temp_directory;
+        std::string output;
+    };
+
+    void die(const std::string& message)
+    {
+        std::fprintf(stderr, "vsort: %s\n", message.c_str());
+        std::exit(2);
+    }
+
+    void die_errno(const std::string& what)
+    {
+        die(what + ": " + std::strerror(errno));
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Keys
+
+    struct record
+    {
+        std::size_t offset;
+        std::size_t size;
+        std::size_t key_offset;
+        std::size_t key_size;
+        std::int64_t number_prefix;
+    };
+
+    inline bool is_blank(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    // Position of the beginning of field (0-based) in [line, line + size),
+    // fields being separated either by opts.separator or by the transition
+    // from a non-blank character to a blank one, leading blanks included
+    std::size_t field_start(const char* line, std::size_t size, std::size_t field,
+                            const options& opts)
+    {
+        std::size_t pos = 0;
+        for (std::size_t f = 0 ; f < field && pos < size ; ++f)
+        {
+            if (opts.separator >= 0)
+            {
+                const void* sep = std::memchr(line + pos, opts.separator, size - pos);
+                if (not sep) return size;
+                pos = static_cast<const char*>(sep) - line + 1;
+            }
+            else
+            {
+                while (pos < size && is_blank(line[pos])) ++pos;
+                while (pos < size && not is_blank(line[pos])) ++pos;
+            }
+        }
+        return pos;
+    }
+
+    std::size_t field_end(const char* line, std::size_t size, std::size_t start,
+                          const options& opts)
+    {
+        if (opts.separator >= 0)
+        {
+            const void* sep = std::memchr(line + start, opts.separator, size - start);
+            return sep ? static_cast<const char*>(sep) - line : size;
+        }
+        std::size_t pos = start;
+        while (pos < size && is_blank(line[pos])) ++pos;
+        while (pos < size && not is_blank(line[pos])) ++pos;
+        return pos;
+    }
+
+    // Leading number of a key, like GNU sort -n: optional blanks, sign,
+    // digits and decimal part, no exponent; the digits are kept as text,
+    // without leading zeros in the integer part nor trailing zeros in the
+    // decimal part, and keys without a number are 0
+    struct number
+    {
+        bool negative;
+        const char* integer;
+        std::size_t integer_size;
+        const char* fraction;
+        std::size_t fraction_size;
+    };
+
+    inline bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    number parse_number(const char* key, std::size_t size)
+    {
+        number res;
+        std::size_t pos = 0;
+        while (pos < size && is_blank(key[pos])) ++pos;
+        res.negative = pos < size && key[pos] == '-';
+        if (res.negative) ++pos;
+
+        while (pos < size && key[pos] == '0') ++pos;
+        res.integer = key + pos;
+        while (pos < size && is_digit(key[pos])) ++pos;
+        res.integer_size = key + pos - res.integer;
+
+        res.fraction = key + pos;
+        res.fraction_size = 0;
+        if (pos < size && key[pos] == '.')
+        {
+            res.fraction = key + pos + 1;
+            for (++pos ; pos < size && is_digit(key[pos]) ; ++pos)
+            {
+                if (key[pos] != '0') res.fraction_size = key + pos + 1 - res.fraction;
+            }
+        }
+
+        // -0 is 0
+        if (res.integer_size == 0 && res.fraction_size == 0) res.negative = false;
+        return res;
+    }
+
+    // Integer ordered like the number as long as numbers differ in their
+    // count of integer digits, up to 4095, or in their first 15 significant
+    // digits. Its lowest bit is set when the number has more digits than
+    // that, which makes it bigger than the numbers it only shares the digits
+    // with: only numbers with equal prefixes and that bit set need
+    // compare_numbers
+    std::int64_t number_prefix(const number& num)
+    {
+        std::int64_t res = std::min<std::size_t>(num.integer_size, 4095);
+        for (std::size_t i = 0 ; i < 15 ; ++i)
+        {
+            char digit = '0';
+            if (i < num.integer_size) digit = num.integer[i];
+            else if (i - num.integer_size < num.fraction_size) digit = num.fraction[i - num.integer_size];
+            res = res * 10 + (digit - '0');
+        }
+        res = 2 * res + (num.integer_size + num.fraction_size > 15);
+        return num.negative ? -res : res;
+    }
+
+    // Three-way comparison of the leading numbers of two keys, exact
+    // whatever the number of digits
+    int compare_numbers(const char* lhs_key, std::size_t lhs_size,
+                        const char* rhs_key, std::size_t rhs_size)
+    {
+        number lhs = parse_number(lhs_key, lhs_size);
+        number rhs = parse_number(rhs_key, rhs_size);
+        if (lhs.negative != rhs.negative) return lhs.negative ? -1 : 1;
+
+        // Compare the absolute values: more integer digits is bigger,
+        // then the digits decide, the missing ones of the shortest
+        // decimal part being zeros
+        int res;
+        if (lhs.integer_size != rhs.integer_size)
+        {
+            res = lhs.integer_size < rhs.integer_size ? -1 : 1;
+        }
+        else
+        {
+            res = std::memcmp(lhs.integer, rhs.integer, lhs.integer_size);
+            if (res == 0)
+            {
+                res = std::memcmp(lhs.fraction, rhs.fraction,
+                                  std::min(lhs.fraction_size, rhs.fraction_size));
+                if (res == 0)
+                {
+                    res = lhs.fraction_size < rhs.fraction_size ? -1 : lhs.fraction_size > rhs.fraction_size;
+                }
+            }
+        }
+        return lhs.negative ? -res : res;
+    }
+
+    // Binary key read as a native unsigned integer, of a width checked
+    // when parsing the options
+    std::uint64_t binary_number(const char* key, std::size_t size)
+    {
+        switch (size)
+        {
+            case 1: { std::uint8_t v; std::memcpy(&v, key, 1); return v; }
+            case 2: { std::uint16_t v; std::memcpy(&v, key, 2); return v; }
+            case 4: { std::uint32_t v; std::memcpy(&v, key, 4); return v; }
+            case 8: { std::uint64_t v; std::memcpy(&v, key, 8); return v; }
+        }
+        return 0;
+    }
+
+    void compute_key(record& rec, const char* base, const options& opts)
+    {
+        const char* data = base + rec.offset;
+        std::size_t begin = 0;
+        std::size_t end = rec.size;
+        if (opts.key_first)
+        {
+            if (opts.record_size)
+            {
+                begin = std::min(opts.key_first - 1, rec.size);
+                if (opts.key_last) end = std::max(begin, std::min(opts.key_last, rec.size));
+            }
+            else
+            {
+                begin = field_start(data, rec.size, opts.key_first - 1, opts);
+                if (opts.key_last)
+                {
+                    std::size_t last = field_start(data, rec.size, opts.key_last - 1, opts);
+                    end = std::max(begin, field_end(data, rec.size, last, opts));
+                }
+            }
+        }
+        rec.key_offset = begin;
+        rec.key_size = end - begin;
+        rec.number_prefix = 0;
+        if (opts.numeric && not opts.record_size)
+        {
+            rec.number_prefix = number_prefix(parse_number(data + begin, end - begin));
+        }
+    }
+
+    int compare_bytes(const char* lhs, std::size_t lhs_size, const char* rhs, std::size_t rhs_size)
+    {
+        int res = std::memcmp(lhs, rhs, std::min(lhs_size, rhs_size));
+        if (res) return res;
+        return lhs_size < rhs_size ? -1 : lhs_size > rhs_size;
+    }
+
+    // Three-way comparison of the keys only
+    int compare_keys(const record& lhs, const char* lhs_base,
+                     const record& rhs, const char* rhs_base, const options& opts)
+    {
+        if (opts.numeric)
+        {
+            if (opts.record_size)
+            {
+                std::uint64_t lhs_number = binary_number(lhs_base + lhs.offset + lhs.key_offset, lhs.key_size);
+                std::uint64_t rhs_number = binary_number(rhs_base + rhs.offset + rhs.key_offset, rhs.key_size);
+                return lhs_number < rhs_number ? -1 : lhs_number > rhs_number;
+            }
+            if (lhs.number_prefix != rhs.number_prefix)
+            {
+                return lhs.number_prefix < rhs.number_prefix ? -1 : 1;
+            }
+            if (not (lhs.number_prefix & 1)) return 0;
+            return compare_numbers(lhs_base + lhs.offset + lhs.key_offset, lhs.key_size,
+                                   rhs_base + rhs.offset + rhs.key_offset, rhs.key_size);
+        }
+        return compare_bytes(lhs_base + lhs.offset + lhs.key_offset, lhs.key_size,
+                             rhs_base + rhs.offset + rhs.key_offset, rhs.key_size);
+    }
+
+    // Full comparison: keys then, unless uniqueness is asked for, the
+    // whole records as a last resort, everything reversed by -r
+    int compare_records(const record& lhs, const char* lhs_base,
+                        const record& rhs, const char* rhs_base, const options& opts)
+    {
+        int res = compare_keys(lhs, lhs_base, rhs, rhs_base, opts);
+        if (res == 0 && not opts.unique && (opts.key_first || opts.numeric))
+        {
+            res = compare_bytes(lhs_base + lhs.offset, lhs.size, rhs_base + rhs.offset, rhs.size);
+        }
+        return opts.reverse ? -res : res;
+    }
+
+    struct record_less
+    {
+        const char* base;
+        const options* opts;
+
+        bool operator()(const record& lhs, const record& rhs) const
+        {
+            return compare_records(lhs, base, rhs, base, *opts) < 0;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////
+    // Input
+
+    // Memory taken by a chunk of records: their text, their descriptors,
+    // and as much again as the descriptors for the scratch memory of the
+    // sort, which never needs more than one descriptor per record
+    std::size_t chunk_memory(std::size_t storage_capacity, std::size_t recs_capacity)
+    {
+        return storage_capacity + 2 * recs_capacity * sizeof(record);
+    }
+
+    // Grows a buffer of a chunk to hold at least needed elements: its
+    // capacity doubles as usual, but not past limit elements
+    template<typename T>
+    void grow(std::vector<T>& vec, std::size_t needed, std::size_t limit)
+    {
+        if (needed <= vec.capacity()) return;
+        vec.reserve(std::max(needed, std::min(2 * vec.capacity(), limit)));
+    }
+
+    // Reads records from a list of files, "-" being the standard input
+    class input
+    {
+        public:
+
+            input(const std::vector<std::string>& files, const options& opts):
+                files_(files),
+                opts_(opts),
+                index_(0),
+                current_(0),
+                pending_(false)
+            {}
+
+            // Replace the contents of storage and recs with the next records,
+            // as many as fit in budget bytes as counted by chunk_memory (the
+            // buffers keep their capacity from one chunk to the next), or a
+            // single one if it is bigger than that; returns false once nothing
+            // is left to read
+            bool read_chunk(std::vector<char>& storage, std::vector<record>& recs,
+                            std::size_t budget)
+            {
+                storage.clear();
+                recs.clear();
+                while (pending_ || read_record())
+                {
+                    pending_ = true;
+                    if (not append(storage, recs, budget)) break;
+                    pending_ = false;
+                }
+                for (std::size_t i = 0 ; i < recs.size() ; ++i)
+                {
+                    compute_key(recs[i], storage.data(), opts_);
+                }
+                return not recs.empty();
+            }
+
+            // Whether every record has been read
+            bool at_end()
+            {
+                if (pending_) return false;
+                while (current_ || open_next())
+                {
+                    int c = getc_unlocked(current_);
+                    if (c != EOF)
+                    {
+                        std::ungetc(c, current_);
+                        return false;
+                    }
+                    close_current();
+                }
+                return true;
+            }
+
+        private:
+
+            bool open_next()
+            {
+                if (index_ >= files_.size()) return false;
+                const std::string& name = files_[index_++];
+                if (name == "-")
+                {
+                    current_ = stdin;
+                }
+                else
+                {
+                    current_ = std::fopen(name.c_str(), "rb");
+                    if (not current_) die_errno(name);
+                }
+                return true;
+            }
+
+            void close_current()
+            {
+                if (current_ != stdin) std::fclose(current_);
+                current_ = 0;
+            }
+
+            // Read the next record into line_, moving on to the next file
+            // when needed; returns false when the input is exhausted
+            bool read_record()
+            {
+                while (current_ || open_next())
+                {
+                    line_.clear();
+                    if (opts_.record_size)
+                    {
+                        line_.resize(opts_.record_size);
+                        std::size_t got = std::fread(line_.data(), 1, opts_.record_size, current_);
+                        if (got == opts_.record_size) return true;
+                        if (got) die("input size is not a multiple of the record size");
+                    }
+                    else
+                    {
+                        int c;
+                        while ((c = getc_unlocked(current_)) != EOF && c != '\n')
+                        {
+                            line_.push_back(char(c));
+                        }
+                        if (c != EOF || not line_.empty()) return true;
+                    }
+                    close_current();
+                }
+                return false;
+            }
+
+            // Append the record in line_ to the chunk, unless the chunk is
+            // not empty and the record would make it exceed the budget
+            bool append(std::vector<char>& storage, std::vector<record>& recs, std::size_t budget)
+            {
+                // The line buffer is kept around and counts too
+                budget = budget > line_.capacity() ? budget - line_.capacity() : 0;
+
+                std::size_t storage_needed = storage.size() + line_.size();
+                std::size_t recs_needed = recs.size() + 1;
+                std::size_t storage_capacity = std::max(storage.capacity(), storage_needed);
+                std::size_t recs_capacity = std::max(recs.capacity(), recs_needed);
+                if (not recs.empty() && chunk_memory(storage_capacity, recs_capacity) > budget)
+                {
+                    return false;
+                }
+
+                // Each buffer may double within what the other one leaves
+                std::size_t used = chunk_memory(storage_capacity, 0);
+                grow(recs, recs_needed, used < budget ? (budget - used) / chunk_memory(0, 1) : 0);
+                used = chunk_memory(0, recs.capacity());
+                grow(storage, storage_needed, used < budget ? budget - used : 0);
+
+                record rec;
+                rec.offset = storage.size();
+                rec.size = line_.size();
+                storage.insert(storage.end(), line_.begin(), line_.end());
+                recs.push_back(rec);
+                return true;
+            }
+
+            std::vector<std::string> files_;
+            const options& opts_;
+            std::size_t index_;
+            std::FILE* current_;
+
+            // Last record read, not appended to a chunk yet when pending_
+            std::vector<char> line_;
+            bool pending_;
+    };
+
+    ////////////////////////////////////////////////////////////
+    // Output
+
+    class output
+    {
+        public:
+
+            explicit output(const options& opts):
+                opts_(opts),
+                has_last_(false)
+            {
+                file_ = opts.output.empty() ? stdout : std::fopen(opts.output.c_str(), "wb");
+                if (not file_) die_errno(opts.output);
+            }
+
+            // Write a record, skipping it if uniqueness is asked for and
+            // its key is equal to the one of the last record written
+            void write(const record& rec, const char* base)
+            {
+                if (opts_.unique)
+                {
+                    if (has_last_ && compare_keys(last_, last_data_.data(), rec, base, opts_) == 0)
+                    {
+                        return;
+                    }
+                    last_data_.assign(base + rec.offset, base + rec.offset + rec.size);
+                    last_ = rec;
+                    last_.offset = 0;
+                    has_last_ = true;
+                }
+                write_raw(base + rec.offset, rec.size);
+            }
+
+            void write_raw(const char* data, std::size_t size)
+            {
+                std::fwrite(data, 1, size, file_);
+                if (not opts_.record_size) putc_unlocked('\n', file_);
+            }
+
+            void close()
+            {
+                if (std::fflush(file_) != 0 || std::ferror(file_)) die_errno("write error");
+                if (file_ != stdout) std::fclose(file_);
+            }
+
+        private:
+
+            const options& opts_;
+            std::FILE* file_;
+            bool has_last_;
+            record last_;
+            std::vector<char> last_data_;
+    };
+
+    ////////////////////////////////////////////////////////////
+    // Sorting
+
+    void sort_chunk(std::vector<char>& storage, std::vector<record>& recs, const options& opts)
+    {
+        record_less compare = { storage.data(), &opts };
+        if (opts.unique)
+        {
+            // Keep the first of equal records in input order
+            parallel_stable_vergesort(recs.begin(), recs.end(), compare, opts.threads);
+        }
+        else if (opts.threads > 1)
+        {
+            parallel_vergesort(recs.begin(), recs.end(), compare, opts.threads);
+        }
+        else
+        {
+            vergesort(recs.begin(), recs.end(), compare);
+        }
+    }
+
+    enum
+    {
+        // Most runs merged at once, as in GNU sort: each of them keeps a
+        // temporary file open
+        merge_fan_in = 16
+    };
+
+    // A sorted chunk spilled to a temporary file, or several of them
+    // already merged; level is the number of merges it went through
+    struct run
+    {
+        std::FILE* file;
+        std::vector<char> storage;
+        record current;
+        std::size_t order;
+        std::size_t level;
+    };
+
+    bool next_record(run& r, const options& opts)
+    {
+        r.storage.clear();
+        r.current.offset = 0;
+        if (opts.record_size)
+        {
+            r.storage.resize(opts.record_size);
+            if (std::fread(r.storage.data(), 1, opts.record_size, r.file) != opts.record_size)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            int c;
+            while ((c = getc_unlocked(r.file)) != EOF && c != '\n') r.storage.push_back(char(c));
+            if (c == EOF) return false;
+        }
+        r.current.size = r.storage.size();
+        compute_key(r.current, r.storage.data(), opts);
+        return true;
+    }
+
+    std::FILE* create_temporary(const options& opts)
+    {
+        std::string pattern = opts.temp_directory + "/vsortXXXXXX";
+        std::vector<char> path(pattern.begin(), pattern.end());
+        path.push_back('\0');
+        int fd = ::mkstemp(path.data());
+        if (fd < 0) die_errno(pattern);
+        ::unlink(path.data());
+        std::FILE* file = ::fdopen(fd, "w+b");
+        if (not file) die_errno("fdopen");
+        return file;
+    }
+
+    void write_record(std::FILE* file, const char* data, std::size_t size, const options& opts)
+    {
+        std::fwrite(data, 1, size, file);
+        if (not opts.record_size) putc_unlocked('\n', file);
+    }
+
+    // Rewinds a temporary file once written; a failed write, such as a
+    // short one on a full disk, would silently lose records
+    void finish_temporary(std::FILE* file)
+    {
+        if (std::fflush(file) != 0 || std::ferror(file)) die_errno("temporary file");
+        std::rewind(file);
+    }
+
+    run spill(const std::vector<char>& storage, const std::vector<record>& recs,
+              const options& opts)
+    {
+        run r = run();
+        r.file = create_temporary(opts);
+        r.level = 0;
+        for (std::size_t i = 0 ; i < recs.size() ; ++i)
+        {
+            write_record(r.file, storage.data() + recs[i].offset, recs[i].size, opts);
+        }
+        finish_temporary(r.file);
+        return r;
+    }
+
+    // Orders runs by their current record, ties broken by run order so
+    // that equal records come out in input order
+    struct run_greater
+    {
+        const std::vector<run>* runs;
+        const options* opts;
+
+        bool operator()(std::size_t lhs, std::size_t rhs) const
+        {
+            const run& l = (*runs)[lhs];
+            const run& r = (*runs)[rhs];
+            int res = compare_records(l.current, l.storage.data(), r.current, r.storage.data(), *opts);
+            if (res) return res > 0;
+            return l.order > r.order;
+        }
+    };
+
+    // Merges runs [first, last), which are in input order, passing each
+    // record to write, then closes their files
+    template<typename Write>
+    void merge_runs(std::vector<run>& runs, std::size_t first, std::size_t last,
+                    const options& opts, Write write)
+    {
+        run_greater greater = { &runs, &opts };
+        std::priority_queue<std::size_t, std::vector<std::size_t>, run_greater> heap(greater);
+        for (std::size_t i = first ; i < last ; ++i)
+        {
+            runs[i].order = i;
+            if (next_record(runs[i], opts)) heap.push(i);
+        }
+        while (not heap.empty())
+        {
+            std::size_t i = heap.top();
+            heap.pop();
+            write(runs[i].current, runs[i].storage.data());
+            if (next_record(runs[i], opts)) heap.push(i);
+        }
+        for (std::size_t i = first ; i < last ; ++i)
+        {
+            std::fclose(runs[i].file);
+        }
+    }
+
+    // Replaces the last merge_fan_in runs with a run merging them
+    void merge_last_runs(std::vector<run>& runs, const options& opts)
+    {
+        std::size_t first = runs.size() - merge_fan_in;
+        run merged = run();
+        merged.file = create_temporary(opts);
+        merged.level = runs[first].level + 1;
+        merge_runs(runs, first, runs.size(), opts,
+                   [&](const record& rec, const char* base) {
+                       write_record(merged.file, base + rec.offset, rec.size, opts);
+                   });
+        finish_temporary(merged.file);
+        runs.resize(first);
+        runs.push_back(merged);
+    }
+
+    // Adds a spilled run; as soon as merge_fan_in runs have the same
+    // level they are merged into a run of the next level, so that the
+    // open files stay few and every record is merged a logarithmic
+    // number of times
+    void add_run(std::vector<run>& runs, const run& r, const options& opts)
+    {
+        runs.push_back(r);
+        // Levels never increase from the oldest run to the newest
+        while (runs.size() >= merge_fan_in &&
+               runs[runs.size() - merge_fan_in].level == runs.back().level)
+        {
+            merge_last_runs(runs, opts);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Command line
+
+    std::size_t parse_size(const char* arg)
+    {
+        char* end;
+        errno = 0;
+        unsigned long long value = std::strtoull(arg, &end, 10);
+        if (errno || end == arg) die(std::string("invalid size: ") + arg);
+        switch (*end)
+        {
+            case 'k': case 'K': value <<= 10; ++end; break;
+            case 'm': case 'M': value <<= 20; ++end; break;
+            case 'g': case 'G': value <<= 30; ++end; break;
+        }
+        if (*end != '\0') die(std::string("invalid size: ") + arg);
+        return value;
+    }
+
+    void parse_key(const char* arg, options& opts)
+    {
+        if (opts.key_first) die("only one key can be given");
+        char* end;
+        opts.key_first = std::strtoul(arg, &end, 10);
+        if (*end == ',') opts.key_last = std::strtoul(end + 1, &end, 10);
+        if (*end != '\0' || opts.key_first == 0 || (opts.key_last && opts.key_last < opts.key_first))
+        {
+            die(std::string("invalid key: ") + arg);
+        }
+    }
+
+    void usage()
+    {
+        std::fputs(
+            "Usage: vsort [OPTION]... [FILE]...\n"
+            "Sort lines of text, or fixed-width records, from FILEs or the standard input.\n"
+            "\n"
+            "  -k, --key=POS1[,POS2]    sort on fields POS1 to POS2 (bytes with --record-size)\n"
+            "  -t, --field-separator=C  use C to separate fields instead of blanks\n"
+            "  -n, --numeric-sort       compare the leading number of the key (the key read as\n"
+            "                           a native unsigned integer of 1, 2, 4 or 8 bytes with\n"
+            "                           --record-size)\n"
+            "  -r, --reverse            reverse the result of comparisons\n"
+            "  -u, --unique             output only the first of records with equal keys\n"
+            "  -o, --output=FILE        write to FILE instead of the standard output\n"
+            "  -S, --buffer-size=SIZE   memory budget before spilling to disk (default 1G)\n"
+            "  -T, --temporary-directory=DIR  directory for spilled runs (default $TMPDIR or /tmp)\n"
+            "      --parallel=N         sort with N threads\n"
+            "      --record-size=N      sort binary records of N bytes instead of lines\n"
+            "  -h, --help               display this help and exit\n",
+            stdout);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    options opts;
+    const char* tmpdir = std::getenv("TMPDIR");
+    opts.temp_directory = tmpdir && *tmpdir ? tmpdir : "/tmp";
+
+    enum { opt_parallel = 256, opt_record_size };
+    static const option long_options[] = {
+        { "key", required_argument, 0, 'k' },
+        { "field-separator", required_argument, 0, 't' },
+        { "numeric-sort", no_argument, 0, 'n' },
+        { "reverse", no_argument, 0, 'r' },
+        { "unique", no_argument, 0, 'u' },
+        { "output", required_argument, 0, 'o' },
+        { "buffer-size", required_argument, 0, 'S' },
+        { "temporary-directory", required_argument, 0, 'T' },
+        { "parallel", required_argument, 0, opt_parallel },
+        { "record-size", required_argument, 0, opt_record_size },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "k:t:nruo:S:T:h", long_options, 0)) != -1)
+    {
+        switch (c)
+        {
+            case 'k': parse_key(optarg, opts); break;
+            case 't':
+                if (std::strlen(optarg) != 1) die("the separator must be a single character");
+                opts.separator = static_cast<unsigned char>(optarg[0]);
+                break;
+            case 'n': opts.numeric = true; break;
+            case 'r': opts.reverse = true; break;
+            case 'u': opts.unique = true; break;
+            case 'o': opts.output = optarg; break;
+            case 'S': opts.memory = std::max<std::size_t>(parse_size(optarg), 1); break;
+            case 'T': opts.temp_directory = optarg; break;
+            case opt_parallel: opts.threads = std::max<std::size_t>(parse_size(optarg), 1); break;
+            case opt_record_size:
+                opts.record_size = parse_size(optarg);
+                if (opts.record_size == 0) die("the record size must be positive");
+                break;
+            case 'h': usage(); return 0;
+            default: return 2;
+        }
+    }
+
+    if (opts.record_size && opts.numeric)
+    {
+        // Binary keys are read as native integers
+        std::size_t first = opts.key_first ? opts.key_first : 1;
+        std::size_t last = opts.key_last ? opts.key_last : opts.record_size;
+        std::size_t width = last >= first ? last - first + 1 : 0;
+        if (last > opts.record_size || (width != 1 && width != 2 && width != 4 && width != 8))
+        {
+            die("numeric keys of binary records must be 1, 2, 4 or 8 bytes inside the record");
+        }
+    }
+
+    std::vector<std::string> files(argv + optind, argv + argc);
+    if (files.empty()) files.push_back("-");
+
+    // Every chunk is spilled before the next one is read, so that only
+    // one of them is ever held in memory
+    input in(files, opts);
+    std::vector<char> storage;
+    std::vector<record> recs;
+    std::vector<run> runs;
+    while (in.read_chunk(storage, recs, opts.memory))
+    {
+        sort_chunk(storage, recs, opts);
+        if (runs.empty() && in.at_end())
+        {
+            // Everything fit in memory
+            output out(opts);
+            for (std::size_t i = 0 ; i < recs.size() ; ++i) out.write(recs[i], storage.data());
+            out.close();
+            return 0;
+        }
+
+        add_run(runs, spill(storage, recs, opts), opts);
+    }
+
+    // Merge the newest runs, which are the smallest, until the rest
+    // fits in a single pass
+    while (runs.size() > merge_fan_in) merge_last_runs(runs, opts);
+    output out(opts);
+    merge_runs(runs, 0, runs.size(), opts,
+               [&](const record& rec, const char* base) { out.write(rec, base); });
+    out.close();
+    return 0;
+}
@@ -0,0 +1,301 @@
+/*
+ * unix_socket_transport.h - Local transport for distributed_vergesort
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef UNIX_SOCKET_TRANSPORT_H_
+#define UNIX_SOCKET_TRANSPORT_H_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "distributed_vergesort.h"
+
+// Transport between processes of a single machine, through a full mesh
+// of Unix domain sockets. Every rank creates the socket directory/<rank>
+// in the given directory, connects to the lower ranks and accepts the
+// connections of the higher ones
+class unix_socket_transport:
+    public verge_transport
+{
+    public:
+
+        unix_socket_transport(const std::string& directory, int rank, int size):
+            rank_(rank),
+            size_(size),
+            peers_(size, -1)
+        {
+            std::string own_path = socket_path(directory, rank);
+            int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listener < 0) throw_errno("socket");
+
+            sockaddr_un address = make_address(own_path);
+            ::unlink(own_path.c_str());
+            if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof address) < 0
+                || ::listen(listener, size) < 0)
+            {
+                ::close(listener);
+                throw_errno("bind");
+            }
+
+            // Lower ranks may not be listening yet, retry until they are
+            for (int peer = 0 ; peer < rank ; ++peer)
+            {
+                sockaddr_un peer_address = make_address(socket_path(directory, peer));
+                while (true)
+                {
+                    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+                    if (fd < 0) throw_errno("socket");
+                    if (::connect(fd, reinterpret_cast<sockaddr*>(&peer_address),
+                                  sizeof peer_address) == 0)
+                    {
+                        std::int32_t id = rank;
+                        write_all(fd, &id, sizeof id);
+                        peers_[peer] = fd;
+                        break;
+                    }
+                    // close may overwrite errno
+                    int error = errno;
+                    ::close(fd);
+                    if (error != ENOENT && error != ECONNREFUSED)
+                    {
+                        throw std::system_error(error, std::system_category(), "connect");
+                    }
+                    ::usleep(1000);
+                }
+            }
+
+            for (int i = rank + 1 ; i < size ; ++i)
+            {
+                int fd = ::accept(listener, 0, 0);
+                if (fd < 0) throw_errno("accept");
+                std::int32_t id;
+                read_all(fd, &id, sizeof id);
+                peers_[id] = fd;
+            }
+            ::close(listener);
+            ::unlink(own_path.c_str());
+
+            for (int peer = 0 ; peer < size ; ++peer)
+            {
+                if (peers_[peer] >= 0)
+                {
+                    ::fcntl(peers_[peer], F_SETFL, ::fcntl(peers_[peer], F_GETFL) | O_NONBLOCK);
+                }
+            }
+        }
+
+        ~unix_socket_transport()
+        {
+            for (std::size_t i = 0 ; i < peers_.size() ; ++i)
+            {
+                if (peers_[i] >= 0) ::close(peers_[i]);
+            }
+        }
+
+        int rank() const
+        {
+            return rank_;
+        }
+
+        int size() const
+        {
+            return size_;
+        }
+
+        // Messages are framed by their size as a 64-bit integer; both
+        // directions are driven by poll so that neither side blocks
+        // while its peer is itself waiting to send
+        void exchange(int to, const void* data, std::size_t bytes,
+                      int from, std::vector<char>& received)
+        {
+            if (to == rank_ && from == rank_)
+            {
+                const char* ptr = static_cast<const char*>(data);
+                received.assign(ptr, ptr + bytes);
+                return;
+            }
+
+            std::uint64_t send_header = bytes;
+            std::uint64_t recv_header = 0;
+            std::size_t sent = 0;
+            std::size_t recv_done = 0;
+            std::size_t send_total = sizeof send_header + bytes;
+            std::size_t recv_total = sizeof recv_header;
+            bool header_received = false;
+            received.clear();
+
+            while (sent < send_total || recv_done < recv_total)
+            {
+                pollfd fds[2];
+                nfds_t nfds = 0;
+                if (sent < send_total)
+                {
+                    fds[nfds].fd = peers_[to];
+                    fds[nfds].events = POLLOUT;
+                    ++nfds;
+                }
+                if (recv_done < recv_total)
+                {
+                    fds[nfds].fd = peers_[from];
+                    fds[nfds].events = POLLIN;
+                    ++nfds;
+                }
+                if (::poll(fds, nfds, -1) < 0)
+                {
+                    if (errno == EINTR) continue;
+                    throw_errno("poll");
+                }
+
+                if (sent < send_total)
+                {
+                    const char* chunk;
+                    std::size_t chunk_size;
+                    if (sent < sizeof send_header)
+                    {
+                        chunk = reinterpret_cast<const char*>(&send_header) + sent;
+                        chunk_size = sizeof send_header - sent;
+                    }
+                    else
+                    {
+                        chunk = static_cast<const char*>(data) + (sent - sizeof send_header);
+                        chunk_size = send_total - sent;
+                    }
+                    ssize_t res = ::send(peers_[to], chunk, chunk_size, MSG_NOSIGNAL);
+                    if (res > 0) sent += res;
+                    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    {
+                        throw_errno("send");
+                    }
+                }
+
+                if (recv_done < recv_total)
+                {
+                    char* chunk;
+                    std::size_t chunk_size;
+                    if (not header_received)
+                    {
+                        chunk = reinterpret_cast<char*>(&recv_header) + recv_done;
+                        chunk_size = sizeof recv_header - recv_done;
+                    }
+                    else
+                    {
+                        chunk = &received[0] + (recv_done - sizeof recv_header);
+                        chunk_size = recv_total - recv_done;
+                    }
+                    ssize_t res = ::recv(peers_[from], chunk, chunk_size, 0);
+                    if (res > 0)
+                    {
+                        recv_done += res;
+                        if (not header_received && recv_done == sizeof recv_header)
+                        {
+                            header_received = true;
+                            received.resize(recv_header);
+                            recv_total += recv_header;
+                        }
+                    }
+                    else if (res == 0)
+                    {
+                        throw std::system_error(ECONNRESET, std::system_category(), "recv");
+                    }
+                    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    {
+                        throw_errno("recv");
+                    }
+                }
+            }
+        }
+
+    private:
+
+        static std::string socket_path(const std::string& directory, int rank)
+        {
+            return directory + "/" + std::to_string(rank);
+        }
+
+        static sockaddr_un make_address(const std::string& path)
+        {
+            sockaddr_un address;
+            std::memset(&address, 0, sizeof address);
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof address.sun_path)
+            {
+                throw std::system_error(ENAMETOOLONG, std::system_category(), path);
+            }
+            std::memcpy(address.sun_path, path.c_str(), path.size());
+            return address;
+        }
+
+        static void throw_errno(const char* what)
+        {
+            throw std::system_error(errno, std::system_category(), what);
+        }
+
+        static void write_all(int fd, const void* data, std::size_t bytes)
+        {
+            const char* ptr = static_cast<const char*>(data);
+            while (bytes)
+            {
+                ssize_t res = ::write(fd, ptr, bytes);
+                if (res < 0)
+                {
+                    if (errno == EINTR) continue;
+                    throw_errno("write");
+                }
+                ptr += res;
+                bytes -= res;
+            }
+        }
+
+        static void read_all(int fd, void* data, std::size_t bytes)
+        {
+            char* ptr = static_cast<char*>(data);
+            while (bytes)
+            {
+                ssize_t res = ::read(fd, ptr, bytes);
+                if (res == 0) throw std::system_error(ECONNRESET, std::system_category(), "read");
+                if (res < 0)
+                {
+                    if (errno == EINTR) continue;
+                    throw_errno("read");
+                }
+                ptr += res;
+                bytes -= res;
+            }
+        }
+
+        int rank_;
+        int size_;
+        std::vector<int> peers_;
+};
+
+#endif // UNIX_SOCKET_TRANSPORT_H_
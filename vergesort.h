@@ -30,28 +30,42 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <vector>
 #include "pdqsort.h"
+#include "vergesort_simd.h"
 
 namespace vergesort_detail
 {
+    // How the random-access vergesort merges runs by default:
+    // std::inplace_merge, which uses a buffer when it can get one
+    struct buffered_merge
+    {
+        template<typename BidirectionalIterator, typename Compare>
+        void operator()(BidirectionalIterator first, BidirectionalIterator middle,
+                        BidirectionalIterator last, Compare compare) const
+        {
+            std::inplace_merge(first, middle, last, compare);
+        }
+    };
+
     // In-place merge where [first, middle1), [middle1, middle2)
     // and [middle2, last) are sorted. The two in-place merges are
     // done in the order that should result in the smallest number
     // of comparisons
-    template<typename BidirectionalIterator, typename Compare>
+    template<typename BidirectionalIterator, typename Compare, typename Merge>
     void inplace_merge3(BidirectionalIterator first, BidirectionalIterator middle1,
                         BidirectionalIterator middle2, BidirectionalIterator last,
-                        Compare compare)
+                        Compare compare, Merge merge)
     {
         if (std::distance(first, middle1) < std::distance(middle2, last))
         {
-            std::inplace_merge(first, middle1, middle2, compare);
-            std::inplace_merge(first, middle2, last, compare);
+            merge(first, middle1, middle2, compare);
+            merge(first, middle2, last, compare);
         }
         else
         {
-            std::inplace_merge(middle1, middle2, last, compare);
-            std::inplace_merge(first, middle1, last, compare);
+            merge(middle1, middle2, last, compare);
+            merge(first, middle1, last, compare);
         }
     }
 
@@ -74,6 +88,219 @@ namespace vergesort_detail
         return last;
     }
 
+    template<typename T, typename U>
+    struct is_same
+    {
+        static const bool value = false;
+    };
+
+    template<typename T>
+    struct is_same<T, T>
+    {
+        static const bool value = true;
+    };
+
+    template<bool Value>
+    struct bool_constant {};
+
+    // Whether Iterator is a pointer or a std::vector iterator over T,
+    // only checked for the types the SIMD layer supports
+    template<typename Iterator, typename T, bool Supported = simd::is_supported<T>::value>
+    struct is_contiguous_simd_iterator
+    {
+        static const bool value = false;
+    };
+
+    template<typename Iterator, typename T>
+    struct is_contiguous_simd_iterator<Iterator, T, true>
+    {
+        static const bool value = is_same<Iterator, T*>::value
+                               || is_same<Iterator, typename std::vector<T>::iterator>::value;
+    };
+
+    // Whether scan_sorted_until can use the vectorized kernel
+    template<typename Iterator, typename Compare>
+    struct is_simd_scannable
+    {
+        typedef typename std::iterator_traits<Iterator>::value_type value_type;
+        static const bool value = simd::enabled
+                               && is_contiguous_simd_iterator<Iterator, value_type>::value
+                               && is_same<Compare, std::less<value_type> >::value;
+    };
+
+    // Vectorized is_sorted_until for std::less: compares every element
+    // with its successor a whole vector at a time
+    template<typename T>
+    T* simd_is_sorted_until(T* first, T* last)
+    {
+        typedef simd::ops<T> ops;
+        while (std::size_t(last - first) > ops::width)
+        {
+            unsigned mask = ops::less(ops::load(first + 1), ops::load(first));
+            if (mask) return first + 1 + simd::lowest_bit(mask);
+            first += ops::width;
+        }
+        return vergesort_detail::is_sorted_until(first, last, std::less<T>());
+    }
+
+    template<typename RandomAccessIterator, typename Compare>
+    RandomAccessIterator scan_sorted_until(RandomAccessIterator first, RandomAccessIterator last,
+                                           Compare compare, bool_constant<false>)
+    {
+        return vergesort_detail::is_sorted_until(first, last, compare);
+    }
+
+    template<typename RandomAccessIterator, typename Compare>
+    RandomAccessIterator scan_sorted_until(RandomAccessIterator first, RandomAccessIterator last,
+                                           Compare, bool_constant<true>)
+    {
+        if (first == last) return last;
+        typename std::iterator_traits<RandomAccessIterator>::pointer ptr = &*first;
+        return first + (simd_is_sorted_until(ptr, ptr + (last - first)) - ptr);
+    }
+
+    // is_sorted_until for the initial scan of the random-access
+    // vergesort, vectorized when possible
+    template<typename RandomAccessIterator, typename Compare>
+    RandomAccessIterator scan_sorted_until(RandomAccessIterator first, RandomAccessIterator last,
+                                           Compare compare)
+    {
+        return scan_sorted_until(first, last, compare,
+                                 bool_constant<is_simd_scannable<RandomAccessIterator, Compare>::value>());
+    }
+
+    // Compare-exchange without branches for scalars: both selects
+    // compile to conditional moves, so that sorting networks do not
+    // pay for mispredictions on random data
+    template<typename RandomAccessIterator, typename Compare>
+    void compare_exchange(RandomAccessIterator a, RandomAccessIterator b, Compare compare)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+        value_type x = *a;
+        value_type y = *b;
+        bool swapped = compare(y, x);
+        *a = swapped ? y : x;
+        *b = swapped ? x : y;
+    }
+
+    template<typename RandomAccessIterator, typename Compare>
+    bool small_sort(RandomAccessIterator, std::size_t, Compare, bool_constant<false>)
+    {
+        return false;
+    }
+
+    // Sorts collections of at most 8 scalars with
+    // size-optimal sorting networks, returns false for any other size
+    template<typename RandomAccessIterator, typename Compare>
+    bool small_sort(RandomAccessIterator first, std::size_t size, Compare compare, bool_constant<true>)
+    {
+        #define VERGESORT_CX(i, j) compare_exchange(first + i, first + j, compare)
+        switch (size)
+        {
+            case 0:
+            case 1:
+                return true;
+            case 2:
+                VERGESORT_CX(0, 1);
+                return true;
+            case 3:
+                VERGESORT_CX(0, 2); VERGESORT_CX(0, 1); VERGESORT_CX(1, 2);
+                return true;
+            case 4:
+                VERGESORT_CX(0, 2); VERGESORT_CX(1, 3); VERGESORT_CX(0, 1); VERGESORT_CX(2, 3);
+                VERGESORT_CX(1, 2);
+                return true;
+            case 5:
+                VERGESORT_CX(0, 3); VERGESORT_CX(1, 4); VERGESORT_CX(0, 2); VERGESORT_CX(1, 3);
+                VERGESORT_CX(0, 1); VERGESORT_CX(2, 4); VERGESORT_CX(1, 2); VERGESORT_CX(3, 4);
+                VERGESORT_CX(2, 3);
+                return true;
+            case 6:
+                VERGESORT_CX(0, 5); VERGESORT_CX(1, 3); VERGESORT_CX(2, 4); VERGESORT_CX(1, 2);
+                VERGESORT_CX(3, 4); VERGESORT_CX(0, 3); VERGESORT_CX(2, 5); VERGESORT_CX(0, 1);
+                VERGESORT_CX(2, 3); VERGESORT_CX(4, 5); VERGESORT_CX(1, 2); VERGESORT_CX(3, 4);
+                return true;
+            case 7:
+                VERGESORT_CX(0, 6); VERGESORT_CX(2, 3); VERGESORT_CX(4, 5); VERGESORT_CX(0, 2);
+                VERGESORT_CX(1, 4); VERGESORT_CX(3, 6); VERGESORT_CX(0, 1); VERGESORT_CX(2, 5);
+                VERGESORT_CX(3, 4); VERGESORT_CX(1, 2); VERGESORT_CX(4, 6); VERGESORT_CX(2, 3);
+                VERGESORT_CX(4, 5); VERGESORT_CX(1, 2); VERGESORT_CX(3, 4); VERGESORT_CX(5, 6);
+                return true;
+            case 8:
+                VERGESORT_CX(0, 2); VERGESORT_CX(1, 3); VERGESORT_CX(4, 6); VERGESORT_CX(5, 7);
+                VERGESORT_CX(0, 4); VERGESORT_CX(1, 5); VERGESORT_CX(2, 6); VERGESORT_CX(3, 7);
+                VERGESORT_CX(0, 1); VERGESORT_CX(2, 3); VERGESORT_CX(4, 5); VERGESORT_CX(6, 7);
+                VERGESORT_CX(2, 4); VERGESORT_CX(3, 5); VERGESORT_CX(1, 4); VERGESORT_CX(3, 6);
+                VERGESORT_CX(1, 2); VERGESORT_CX(3, 4); VERGESORT_CX(5, 6);
+                return true;
+            default:
+                return false;
+        }
+        #undef VERGESORT_CX
+    }
+
+    // Sorts a block of at most 8 elements, with a sorting
+    // network for scalars and an insertion sort otherwise
+    template<typename RandomAccessIterator, typename Compare>
+    void sort_block(RandomAccessIterator first, std::size_t size, Compare compare)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+        if (not small_sort(first, size, compare, bool_constant<simd::is_supported<value_type>::value>()))
+        {
+            pdqsort_detail::insertion_sort(first, first + size, compare);
+        }
+    }
+
+    // Pre-pass over a segment without big runs, in the spirit of quadsort:
+    // blocks of 4 elements are sorted with a network, and chains of
+    // strictly descending blocks are reversed at once. Stops as soon as
+    // two consecutive blocks are out of order, so that shuffled segments
+    // only pay for a couple of blocks; returns whether the whole segment
+    // is sorted, in which case the quicksort can be skipped
+    template<typename RandomAccessIterator, typename Compare>
+    bool quad_prepass(RandomAccessIterator first, RandomAccessIterator last, Compare compare)
+    {
+        RandomAccessIterator block = first;
+        while (last - block >= 4)
+        {
+            RandomAccessIterator block_end = block;
+            while (last - block_end >= 4
+                   && compare(block_end[1], block_end[0])
+                   && compare(block_end[2], block_end[1])
+                   && compare(block_end[3], block_end[2])
+                   && (block_end == block || compare(block_end[0], block_end[-1])))
+            {
+                block_end += 4;
+            }
+
+            if (block_end != block)
+            {
+                std::reverse(block, block_end);
+            }
+            else
+            {
+                sort_block(block, 4, compare);
+                block_end = block + 4;
+            }
+
+            if (block != first && compare(*block, block[-1])) return false;
+            block = block_end;
+        }
+
+        sort_block(block, last - block, compare);
+        return block == first || block == last || not compare(*block, block[-1]);
+    }
+
+    // Sorts a segment that vergesort could not split into runs
+    template<typename RandomAccessIterator, typename Compare>
+    void sort_unstable(RandomAccessIterator first, RandomAccessIterator last, Compare compare)
+    {
+        if (not quad_prepass(first, last, compare))
+        {
+            pdqsort(first, last, compare);
+        }
+    }
+
     // partial application structs for partition
     template<typename T, typename Compare>
     struct partition_pivot_left
@@ -165,7 +392,7 @@ namespace vergesort_detail
         }
 
         // Limit under which quicksort is used
-        int unstable_limit = dist / pdqsort_detail::log2(dist);
+        difference_type unstable_limit = dist / pdqsort_detail::log2(dist);
 
         // Beginning of an unstable partition, last if the
         // previous partition is stable
@@ -267,31 +494,46 @@ namespace vergesort_detail
         }
     }
 
-    // vergesort for random-access iterators
-    template<typename RandomAccessIterator, typename Compare>
-    void vergesort(RandomAccessIterator first, RandomAccessIterator last, Compare compare,
-                   std::random_access_iterator_tag)
+    // What the random-access vergesort found while scanning
+    // the collection
+    struct vergesort_stats
     {
-        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
-        difference_type dist = std::distance(first, last);
+        // Number of sorted or reverse-sorted runs big enough to
+        // be merged
+        std::size_t runs;
 
-        if (dist < 80)
-        {
-            // vergesort is inefficient for small collections
-            pdqsort(first, last, compare);
-            return;
-        }
+        // How many of these runs were reverse-sorted
+        std::size_t descending_runs;
 
-        // Limit under which pdqsort is used
-        difference_type unstable_limit = dist / pdqsort_detail::log2(dist);
+        // Number of elements sorted by the fallback pdqsort
+        std::size_t fallback_size;
+
+        vergesort_stats():
+            runs(0),
+            descending_runs(0),
+            fallback_size(0)
+        {}
+    };
 
+    // vergesort for random-access iterators, with an explicit size under
+    // which runs are not worth merging and an explicit merge function;
+    // fills stats when it is not null
+    template<typename RandomAccessIterator, typename Compare, typename Merge>
+    void vergesort(RandomAccessIterator first, RandomAccessIterator last, Compare compare,
+                   typename std::iterator_traits<RandomAccessIterator>::difference_type unstable_limit,
+                   vergesort_stats* stats, Merge merge)
+    {
         // Beginning of an unstable partition, last if the
         // previous partition is stable
         RandomAccessIterator begin_unstable = last;
 
         // Pair of iterators to iterate through the collection
-        RandomAccessIterator next = vergesort_detail::is_sorted_until(first, last, compare);
-        if (next == last) return;
+        RandomAccessIterator next = vergesort_detail::scan_sorted_until(first, last, compare);
+        if (next == last)
+        {
+            if (stats) stats->runs += 1;
+            return;
+        }
         RandomAccessIterator current = next - 1;
 
         while (true)
@@ -341,8 +583,13 @@ namespace vergesort_detail
                 // Check whether we found a big enough sorted sequence
                 if (std::distance(current, next2) >= unstable_limit)
                 {
-                    pdqsort(begin_unstable, current, compare);
-                    vergesort_detail::inplace_merge3(first, begin_unstable, current, next2, compare);
+                    sort_unstable(begin_unstable, current, compare);
+                    vergesort_detail::inplace_merge3(first, begin_unstable, current, next2, compare, merge);
+                    if (stats)
+                    {
+                        stats->runs += 1;
+                        stats->fallback_size += std::distance(begin_unstable, current);
+                    }
                     begin_unstable = last;
                 }
             }
@@ -371,9 +618,15 @@ namespace vergesort_detail
                 // Check whether we found a big enough sorted sequence
                 if (std::distance(current, next2) >= unstable_limit)
                 {
-                    pdqsort(begin_unstable, current, compare);
+                    sort_unstable(begin_unstable, current, compare);
                     std::reverse(current, next2);
-                    vergesort_detail::inplace_merge3(first, begin_unstable, current, next2, compare);
+                    vergesort_detail::inplace_merge3(first, begin_unstable, current, next2, compare, merge);
+                    if (stats)
+                    {
+                        stats->runs += 1;
+                        stats->descending_runs += 1;
+                        stats->fallback_size += std::distance(begin_unstable, current);
+                    }
                     begin_unstable = last;
                 }
             }
@@ -388,10 +641,65 @@ namespace vergesort_detail
         {
             // If there are unsorted elements left,
             // sort them and merge everything
-            pdqsort(begin_unstable, last, compare);
-            std::inplace_merge(first, begin_unstable, last, compare);
+            sort_unstable(begin_unstable, last, compare);
+            merge(first, begin_unstable, last, compare);
+            if (stats) stats->fallback_size += std::distance(begin_unstable, last);
         }
     }
+
+    template<typename RandomAccessIterator, typename Compare>
+    void vergesort(RandomAccessIterator first, RandomAccessIterator last, Compare compare,
+                   typename std::iterator_traits<RandomAccessIterator>::difference_type unstable_limit,
+                   vergesort_stats* stats)
+    {
+        vergesort(first, last, compare, unstable_limit, stats, buffered_merge());
+    }
+
+    // vergesort for random-access iterators, fills stats when it is not
+    // null; small collections count as sorted by the fallback
+    template<typename RandomAccessIterator, typename Compare>
+    void vergesort(RandomAccessIterator first, RandomAccessIterator last, Compare compare,
+                   vergesort_stats* stats, std::random_access_iterator_tag)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+        difference_type dist = std::distance(first, last);
+
+        if (dist < 80)
+        {
+            if (stats) stats->fallback_size += dist;
+
+            // vergesort is inefficient for small collections, and tiny
+            // collections of scalars are cheaper to sort with networks
+            typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+            if (small_sort(first, dist, compare, bool_constant<simd::is_supported<value_type>::value>()))
+            {
+                return;
+            }
+            pdqsort(first, last, compare);
+            return;
+        }
+
+        // Limit under which pdqsort is used
+        difference_type unstable_limit = dist / pdqsort_detail::log2(dist);
+        vergesort(first, last, compare, unstable_limit, stats);
+    }
+
+    // The bidirectional vergesort does not gather stats
+    template<typename BidirectionalIterator, typename Compare>
+    void vergesort(BidirectionalIterator first, BidirectionalIterator last, Compare compare,
+                   vergesort_stats*, std::bidirectional_iterator_tag)
+    {
+        vergesort(first, last, compare, std::bidirectional_iterator_tag());
+    }
+
+    // vergesort for random-access iterators
+    template<typename RandomAccessIterator, typename Compare>
+    void vergesort(RandomAccessIterator first, RandomAccessIterator last, Compare compare,
+                   std::random_access_iterator_tag)
+    {
+        vergesort(first, last, compare, static_cast<vergesort_stats*>(0),
+                  std::random_access_iterator_tag());
+    }
 }
 
 template<typename BidirectionalIterator, typename Compare>
@@ -0,0 +1,243 @@
+/*
+ * vergesort_adaptive.h - vergesort tuning itself for a call site
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_ADAPTIVE_H_
+#define VERGESORT_ADAPTIVE_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include "pdqsort.h"
+#include "vergesort.h"
+#include "vergesort_radix.h"
+
+// Sorter meant to be kept around for a given call site: it records
+// what the vergesort scan finds and how long every strategy takes, and
+// uses that history to pick the best strategy for the next calls. The
+// scan is run again from time to time in case the data changes.
+// Instances are not thread-safe.
+template<typename T, typename Compare = std::less<T> >
+class vergesort_adaptive
+{
+    public:
+
+        enum strategy
+        {
+            // Plain vergesort
+            scan,
+            // vergesort only merging runs longer than usual
+            scan_long_runs,
+            // vergesort also merging runs shorter than usual
+            scan_short_runs,
+            // Skip the scan entirely
+            pdqsort_only,
+            // Skip the scan, integers compared with std::less only
+            radix_only,
+            strategies_count
+        };
+
+        // The scan is run every reprobe_interval calls
+        explicit vergesort_adaptive(Compare compare = Compare(), unsigned reprobe_interval = 32):
+            compare_(compare),
+            reprobe_interval_(reprobe_interval ? reprobe_interval : 1),
+            calls_(0),
+            profile_(profile_unknown),
+            last_strategy_(scan)
+        {
+            reset_costs();
+        }
+
+        template<typename RandomAccessIterator>
+        void operator()(RandomAccessIterator first, RandomAccessIterator last)
+        {
+            typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+            typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+            static_assert(std::is_same<value_type, T>::value,
+                          "vergesort_adaptive<T> sorts collections of T");
+
+            difference_type dist = std::distance(first, last);
+            if (dist < 80)
+            {
+                // Nothing to learn there: vergesort hands small inputs
+                // to its sorting networks when it can, pdqsort otherwise
+                ::vergesort(first, last, compare_);
+                return;
+            }
+
+            strategy chosen = choose();
+            difference_type unstable_limit = dist / pdqsort_detail::log2(dist);
+            vergesort_detail::vergesort_stats stats;
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            switch (chosen)
+            {
+                case scan:
+                    vergesort_detail::vergesort(first, last, compare_, unstable_limit, &stats);
+                    break;
+                case scan_long_runs:
+                    vergesort_detail::vergesort(first, last, compare_, unstable_limit * 4, &stats);
+                    break;
+                case scan_short_runs:
+                    vergesort_detail::vergesort(first, last, compare_,
+                                                std::max<difference_type>(unstable_limit / 4, 2),
+                                                &stats);
+                    break;
+                case pdqsort_only:
+                    pdqsort(first, last, compare_);
+                    break;
+                case radix_only:
+                    vergesort_detail::radix_sort_if_possible(
+                        first, last, vergesort_detail::is_radix_sortable<T, Compare>()
+                    );
+                    break;
+                default:
+                    break;
+            }
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            double ns_per_element = std::chrono::duration<double, std::nano>(end - start).count() / dist;
+            record(chosen, ns_per_element);
+            if (chosen == scan)
+            {
+                last_stats_ = stats;
+                classify(double(stats.fallback_size) / dist);
+            }
+            last_strategy_ = chosen;
+            ++calls_;
+        }
+
+        // Strategy used by the last call
+        strategy last_strategy() const
+        {
+            return last_strategy_;
+        }
+
+        // What the last plain vergesort scan found
+        const vergesort_detail::vergesort_stats& last_stats() const
+        {
+            return last_stats_;
+        }
+
+        // Average cost of a strategy in nanoseconds per element,
+        // negative if it was not tried since the data last changed
+        double cost(strategy s) const
+        {
+            return costs_[s];
+        }
+
+    private:
+
+        // What the scan says about the data
+        enum profile
+        {
+            profile_unknown,
+            // Almost everything ends up in the fallback sort
+            profile_random,
+            // Almost nothing ends up in the fallback sort
+            profile_presorted,
+            profile_mixed
+        };
+
+        void reset_costs()
+        {
+            for (int i = 0 ; i < strategies_count ; ++i)
+            {
+                costs_[i] = -1.0;
+            }
+        }
+
+        void record(strategy s, double ns_per_element)
+        {
+            // Exponentially weighted moving average
+            if (costs_[s] < 0.0) costs_[s] = ns_per_element;
+            else costs_[s] = 0.75 * costs_[s] + 0.25 * ns_per_element;
+        }
+
+        void classify(double fallback_fraction)
+        {
+            profile p = fallback_fraction >= 0.9 ? profile_random
+                      : fallback_fraction <= 0.1 ? profile_presorted
+                      : profile_mixed;
+            if (p != profile_)
+            {
+                // Timings gathered on other data are meaningless
+                double scan_cost = costs_[scan];
+                reset_costs();
+                costs_[scan] = scan_cost;
+                profile_ = p;
+            }
+        }
+
+        strategy choose() const
+        {
+            if (calls_ % reprobe_interval_ == 0 || profile_ == profile_unknown)
+            {
+                return scan;
+            }
+
+            strategy candidates[strategies_count];
+            int nb_candidates = 0;
+            candidates[nb_candidates++] = scan;
+            switch (profile_)
+            {
+                case profile_random:
+                    candidates[nb_candidates++] = pdqsort_only;
+                    if (vergesort_detail::is_radix_sortable<T, Compare>::value)
+                    {
+                        candidates[nb_candidates++] = radix_only;
+                    }
+                    break;
+                case profile_presorted:
+                    candidates[nb_candidates++] = scan_short_runs;
+                    break;
+                default:
+                    candidates[nb_candidates++] = scan_long_runs;
+                    candidates[nb_candidates++] = scan_short_runs;
+                    break;
+            }
+
+            // Try every candidate once, then stick to the cheapest
+            strategy best = scan;
+            for (int i = 0 ; i < nb_candidates ; ++i)
+            {
+                if (costs_[candidates[i]] < 0.0) return candidates[i];
+                if (costs_[candidates[i]] < costs_[best]) best = candidates[i];
+            }
+            return best;
+        }
+
+        Compare compare_;
+        unsigned reprobe_interval_;
+        unsigned long long calls_;
+        profile profile_;
+        strategy last_strategy_;
+        double costs_[strategies_count];
+        vergesort_detail::vergesort_stats last_stats_;
+};
+
+#endif // VERGESORT_ADAPTIVE_H_
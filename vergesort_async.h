@@ -0,0 +1,589 @@
+/*
+ * vergesort_async.h - vergesort as a C++20 coroutine
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_ASYNC_H_
+#define VERGESORT_ASYNC_H_
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "parallel_vergesort.h"
+#include "vergesort.h"
+#include "vergesort_inplace.h"
+
+namespace vergesort_detail
+{
+    enum {
+        // Number of elements scanned, sorted or reversed by a single
+        // step of vergesort_async
+        async_step_size = 1 << 16,
+
+        // Biggest merge done by a single step of vergesort_async, bigger
+        // ones are split first: merging is much cheaper per element than
+        // sorting, and every split costs a rotation
+        async_merge_size = 1 << 20
+    };
+
+    // Awaitable that hands a batch of jobs to an executor and resumes the
+    // awaiting coroutine once all of them have run, on the thread that ran
+    // the last one. The jobs are independent and may run concurrently.
+    // When the executor runs them inline, the coroutine is not suspended
+    // at all instead of being resumed from within the executor
+    template<typename Executor>
+    class offload
+    {
+        public:
+
+            offload(Executor& executor, std::vector<std::function<void()>>& jobs):
+                executor_(executor),
+                jobs_(jobs),
+                pending_(jobs.size() + 1)
+            {}
+
+            bool await_ready() const noexcept
+            {
+                return jobs_.empty();
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                handle_ = handle;
+                for (std::size_t i = 0 ; i < jobs_.size() ; ++i)
+                {
+                    executor_([this, i] { run(i); });
+                }
+                return not finish();
+            }
+
+            void await_resume()
+            {
+                jobs_.clear();
+                if (error_) std::rethrow_exception(error_);
+            }
+
+        private:
+
+            void run(std::size_t i)
+            {
+                try
+                {
+                    jobs_[i]();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (not error_) error_ = std::current_exception();
+                }
+                if (finish()) handle_.resume();
+            }
+
+            // Whether the caller is the last one to be done
+            bool finish()
+            {
+                return pending_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            }
+
+            Executor& executor_;
+            std::vector<std::function<void()>>& jobs_;
+            std::atomic<std::size_t> pending_;
+            std::coroutine_handle<> handle_;
+            std::mutex mutex_;
+            std::exception_ptr error_;
+    };
+
+    // Adds independent jobs reversing [first, last), each of them swapping
+    // at most async_step_size elements
+    template<typename RandomAccessIterator>
+    void add_reverse_jobs(RandomAccessIterator first, RandomAccessIterator last,
+                          std::vector<std::function<void()>>& jobs)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+
+        difference_type half = std::distance(first, last) / 2;
+        for (difference_type begin = 0 ; begin < half ; begin += async_step_size / 2)
+        {
+            difference_type end = std::min<difference_type>(half, begin + async_step_size / 2);
+            jobs.push_back([=] {
+                for (difference_type i = begin ; i < end ; ++i)
+                {
+                    std::iter_swap(first + i, last - 1 - i);
+                }
+            });
+        }
+    }
+
+    // The scan of the random-access vergesort, cut into steps: instead of
+    // sorting and merging as it goes, it records the bounds of the sorted
+    // runs it finds, the reverse-sorted runs and the unsorted segments
+    // between them, which together cover the whole collection
+    template<typename RandomAccessIterator, typename Compare>
+    class async_scanner
+    {
+        public:
+
+            typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+
+            // What the next step does: jump to the next position where a
+            // run could be, or walk back to its beginning, or forward to
+            // its end
+            enum phase
+            {
+                jump_phase,
+                backward_phase,
+                forward_phase
+            };
+
+            struct segment
+            {
+                RandomAccessIterator first;
+                RandomAccessIterator last;
+                bool sorted;
+                bool descending;
+            };
+
+            async_scanner(RandomAccessIterator first, RandomAccessIterator last,
+                          Compare compare, difference_type unstable_limit):
+                first_(first),
+                last_(last),
+                compare_(compare),
+                unstable_limit_(unstable_limit),
+                prefix_(true),
+                done_(false),
+                current_(first),
+                next_(first),
+                begin_unstable_(last),
+                phase_(jump_phase),
+                begin_range_(first),
+                current2_(first),
+                next2_(first),
+                descending_(false)
+            {}
+
+            bool done() const
+            {
+                return done_;
+            }
+
+            const std::vector<segment>& segments() const
+            {
+                return segments_;
+            }
+
+            // Examines about budget more elements: the walks along a run
+            // are counted as well and resume at the next step when they
+            // exceed the budget
+            void step(difference_type budget)
+            {
+                if (prefix_)
+                {
+                    scan_prefix(budget);
+                    return;
+                }
+
+                while (true)
+                {
+                    if (phase_ == jump_phase)
+                    {
+                        if (budget <= 0) return;
+                        --budget;
+                        begin_range_ = current_;
+
+                        if (std::distance(next_, last_) <= unstable_limit_)
+                        {
+                            if (begin_unstable_ == last_) begin_unstable_ = begin_range_;
+                            finish();
+                            return;
+                        }
+
+                        current_ += unstable_limit_;
+                        next_ += unstable_limit_;
+                        current2_ = current_;
+                        next2_ = next_;
+                        descending_ = not compare_(*current_, *next_);
+                        phase_ = backward_phase;
+                    }
+                    else if (phase_ == backward_phase)
+                    {
+                        // Look for the beginning of the run
+                        while (true)
+                        {
+                            if (current_ == begin_range_)
+                            {
+                                phase_ = forward_phase;
+                                break;
+                            }
+                            if (budget <= 0) return;
+                            --budget;
+                            --current_;
+                            --next_;
+                            if (breaks_run(current_, next_))
+                            {
+                                ++current_;
+                                phase_ = forward_phase;
+                                break;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        // Look for the end of the run
+                        while (next2_ != last_ && not breaks_run(current2_, next2_))
+                        {
+                            if (budget <= 0) return;
+                            --budget;
+                            ++current2_;
+                            ++next2_;
+                        }
+
+                        if (begin_unstable_ == last_) begin_unstable_ = begin_range_;
+                        if (std::distance(current_, next2_) >= unstable_limit_)
+                        {
+                            add(begin_unstable_, current_, false, false);
+                            add(current_, next2_, true, descending_);
+                            begin_unstable_ = last_;
+                        }
+
+                        if (next2_ == last_)
+                        {
+                            finish();
+                            return;
+                        }
+                        current_ = current2_ + 1;
+                        next_ = next2_ + 1;
+                        phase_ = jump_phase;
+                    }
+                }
+            }
+
+        private:
+
+            // Looks for the end of the initial sorted run, a chunk at a time
+            void scan_prefix(difference_type budget)
+            {
+                RandomAccessIterator chunk_last = std::distance(next_, last_) > budget ? next_ + budget : last_;
+                RandomAccessIterator sorted_until = scan_sorted_until(next_, chunk_last, compare_);
+                if (sorted_until == chunk_last && chunk_last != last_
+                    && not compare_(*chunk_last, *(chunk_last - 1)))
+                {
+                    next_ = chunk_last;
+                    return;
+                }
+
+                next_ = sorted_until;
+                prefix_ = false;
+                if (next_ == last_)
+                {
+                    add(first_, last_, true, false);
+                    done_ = true;
+                    return;
+                }
+                current_ = next_ - 1;
+                add(first_, current_, true, false);
+            }
+
+            // Whether *next, which follows *current, does not extend the
+            // run being examined
+            bool breaks_run(RandomAccessIterator current, RandomAccessIterator next)
+            {
+                return descending_ ? compare_(*current, *next) : compare_(*next, *current);
+            }
+
+            void add(RandomAccessIterator first, RandomAccessIterator last, bool sorted, bool descending)
+            {
+                if (first == last) return;
+                segment seg = { first, last, sorted, descending };
+                segments_.push_back(seg);
+            }
+
+            void finish()
+            {
+                if (begin_unstable_ != last_) add(begin_unstable_, last_, false, false);
+                done_ = true;
+            }
+
+            RandomAccessIterator first_;
+            RandomAccessIterator last_;
+            Compare compare_;
+            difference_type unstable_limit_;
+            bool prefix_;
+            bool done_;
+            RandomAccessIterator current_;
+            RandomAccessIterator next_;
+            RandomAccessIterator begin_unstable_;
+            phase phase_;
+            RandomAccessIterator begin_range_;
+            RandomAccessIterator current2_;
+            RandomAccessIterator next2_;
+            bool descending_;
+            std::vector<segment> segments_;
+    };
+}
+
+// Coroutine returned by vergesort_async: it starts when awaited, and
+// resumes its awaiter once the collection is sorted, rethrowing the
+// exception of the sort if there was one
+class vergesort_task
+{
+    public:
+
+        struct promise_type
+        {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+
+            vergesort_task get_return_object()
+            {
+                return vergesort_task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            struct final_awaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    std::coroutine_handle<> continuation = handle.promise().continuation;
+                    if (continuation) return continuation;
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            final_awaiter final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void() {}
+
+            void unhandled_exception()
+            {
+                error = std::current_exception();
+            }
+        };
+
+        vergesort_task(vergesort_task&& other) noexcept:
+            handle_(std::exchange(other.handle_, nullptr))
+        {}
+
+        vergesort_task& operator=(vergesort_task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle_) handle_.destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        ~vergesort_task()
+        {
+            if (handle_) handle_.destroy();
+        }
+
+        bool await_ready() const noexcept
+        {
+            return not handle_ || handle_.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+        {
+            handle_.promise().continuation = awaiter;
+            return handle_;
+        }
+
+        void await_resume()
+        {
+            if (handle_ && handle_.promise().error)
+            {
+                std::rethrow_exception(handle_.promise().error);
+            }
+        }
+
+    private:
+
+        explicit vergesort_task(std::coroutine_handle<promise_type> handle):
+            handle_(handle)
+        {}
+
+        std::coroutine_handle<promise_type> handle_;
+};
+
+// Sorts [first, last) in small resumable steps for event loops that cannot
+// afford to be blocked by a big sort: co_await vergesort_async(first, last,
+// compare, executor). Every step is a job handed to executor, any object
+// that can be called with a nullary function object and runs it later:
+// posting to the event loop itself interleaves the steps with the other
+// events, posting to a thread pool offloads the sort entirely. The scan for
+// runs proceeds async_step_size elements at a time; then the unsorted
+// segments, cut into chunks of async_step_size elements, are sorted and the
+// reverse-sorted runs are reversed a chunk at a time, all as independent
+// jobs; finally the sorted parts are merged pairwise, a round of independent
+// merges at a time, the biggest merges being split into smaller independent
+// ones first.
+// The awaiting coroutine is resumed on the thread that ran the last step.
+// The collection must not be touched until then
+template<typename RandomAccessIterator, typename Compare, typename Executor>
+vergesort_task vergesort_async(RandomAccessIterator first, RandomAccessIterator last,
+                               Compare compare, Executor executor)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+    typedef vergesort_detail::async_scanner<RandomAccessIterator, Compare> scanner_type;
+
+    std::vector<std::function<void()>> jobs;
+    difference_type dist = std::distance(first, last);
+
+    if (dist <= vergesort_detail::async_step_size)
+    {
+        jobs.push_back([=] { vergesort(first, last, compare); });
+        co_await vergesort_detail::offload<Executor>(executor, jobs);
+        co_return;
+    }
+
+    scanner_type scanner(first, last, compare, dist / pdqsort_detail::log2(dist));
+    while (not scanner.done())
+    {
+        jobs.push_back([&scanner] { scanner.step(vergesort_detail::async_step_size); });
+        co_await vergesort_detail::offload<Executor>(executor, jobs);
+    }
+
+    // Turn every segment into sorted parts
+    std::vector<RandomAccessIterator> bounds;
+    bounds.push_back(first);
+    for (const typename scanner_type::segment& seg: scanner.segments())
+    {
+        if (seg.sorted)
+        {
+            if (seg.descending)
+            {
+                vergesort_detail::add_reverse_jobs(seg.first, seg.last, jobs);
+            }
+            bounds.push_back(seg.last);
+            continue;
+        }
+
+        RandomAccessIterator begin = seg.first;
+        while (begin != seg.last)
+        {
+            RandomAccessIterator end = std::distance(begin, seg.last) > vergesort_detail::async_step_size
+                                     ? begin + vergesort_detail::async_step_size : seg.last;
+            jobs.push_back([=] { vergesort_detail::sort_unstable(begin, end, compare); });
+            bounds.push_back(end);
+            begin = end;
+        }
+    }
+    co_await vergesort_detail::offload<Executor>(executor, jobs);
+
+    // Merge neighbouring parts pairwise, one round at a time. Merges
+    // bigger than async_merge_size are split in two independent ones as
+    // SymMerge does, at the cost of a rotation, until all of them fit
+    // in a step. Big rotations are done as three reversals cut into
+    // steps: both blocks are reversed in a first round of jobs, then the
+    // whole range in a second one
+    struct pending_merge
+    {
+        RandomAccessIterator first;
+        RandomAccessIterator middle;
+        RandomAccessIterator last;
+    };
+
+    while (bounds.size() > 2)
+    {
+        std::vector<RandomAccessIterator> merged;
+        std::vector<pending_merge> merges;
+        merged.push_back(bounds[0]);
+        for (std::size_t i = 0 ; i + 2 < bounds.size() ; i += 2)
+        {
+            merges.push_back({ bounds[i], bounds[i+1], bounds[i+2] });
+            merged.push_back(bounds[i+2]);
+        }
+        // Odd part out, carried over to the next round
+        if (bounds.size() % 2 == 0)
+        {
+            merged.push_back(bounds.back());
+        }
+
+        while (not merges.empty())
+        {
+            std::vector<pending_merge> halves;
+            std::vector<std::function<void()>> rotations;
+            for (const pending_merge& merge: merges)
+            {
+                if (merge.first == merge.middle || merge.middle == merge.last) continue;
+                if (not compare(*merge.middle, *(merge.middle - 1))) continue;
+
+                if (std::distance(merge.first, merge.last) <= vergesort_detail::async_merge_size)
+                {
+                    jobs.push_back([=] {
+                        vergesort_detail::merge_adjacent(merge.first, merge.middle, merge.last, compare);
+                    });
+                    continue;
+                }
+
+                vergesort_detail::merge_split<RandomAccessIterator> split =
+                    vergesort_detail::symmerge_split(merge.first, merge.middle, merge.last, compare);
+                RandomAccessIterator start = merge.first + split.start;
+                RandomAccessIterator half = merge.first + split.half;
+                RandomAccessIterator end = merge.first + split.end;
+                RandomAccessIterator middle = merge.middle;
+                if (std::distance(start, end) <= vergesort_detail::async_step_size)
+                {
+                    jobs.push_back([=] { vergesort_detail::rotate(start, middle, end); });
+                }
+                else
+                {
+                    vergesort_detail::add_reverse_jobs(start, middle, jobs);
+                    vergesort_detail::add_reverse_jobs(middle, end, jobs);
+                    vergesort_detail::add_reverse_jobs(start, end, rotations);
+                }
+                halves.push_back({ merge.first, start, half });
+                halves.push_back({ half, end, merge.last });
+            }
+            co_await vergesort_detail::offload<Executor>(executor, jobs);
+            jobs.swap(rotations);
+            co_await vergesort_detail::offload<Executor>(executor, jobs);
+            merges.swap(halves);
+        }
+        bounds.swap(merged);
+    }
+}
+
+#endif // VERGESORT_ASYNC_H_
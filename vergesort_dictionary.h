@@ -0,0 +1,188 @@
+/*
+ * vergesort_dictionary.h - sorting dictionary-encoded strings
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_DICTIONARY_H_
+#define VERGESORT_DICTIONARY_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+#include "vergesort.h"
+#include "vergesort_radix.h"
+
+namespace vergesort_detail
+{
+    template<typename Dictionary, typename Compare>
+    struct compare_entries
+    {
+        const Dictionary* dictionary;
+        Compare compare;
+
+        bool operator()(std::uint32_t lhs, std::uint32_t rhs) const
+        {
+            return compare((*dictionary)[lhs], (*dictionary)[rhs]);
+        }
+    };
+
+    // Compares C strings by their contents, byte by byte like std::string
+    struct compare_c_strings
+    {
+        bool operator()(const char* lhs, const char* rhs) const
+        {
+            return std::strcmp(lhs, rhs) < 0;
+        }
+    };
+
+    // Comparison used when none is given: std::less, except for
+    // dictionaries of C strings where it would compare addresses
+    template<typename Entry>
+    struct default_entry_compare
+    {
+        typedef std::less<Entry> type;
+    };
+
+    template<>
+    struct default_entry_compare<const char*>
+    {
+        typedef compare_c_strings type;
+    };
+
+    template<>
+    struct default_entry_compare<char*>
+    {
+        typedef compare_c_strings type;
+    };
+
+    template<typename Dictionary>
+    struct dictionary_compare:
+        default_entry_compare<typename std::decay<decltype(std::declval<const Dictionary&>()[0])>::type>
+    {};
+}
+
+// Order-preserving ranks of the entries of a dictionary: ranks[code] is the
+// position of dictionary[code] once the dictionary is sorted with compare.
+// Every code gets a distinct rank, equivalent entries get adjacent ones
+template<typename Dictionary, typename Compare>
+std::vector<std::uint32_t> vergesort_dictionary_ranks(const Dictionary& dictionary, Compare compare)
+{
+    std::size_t size = dictionary.size();
+    std::vector<std::uint32_t> order(size);
+    for (std::size_t i = 0 ; i < size ; ++i)
+    {
+        order[i] = std::uint32_t(i);
+    }
+    vergesort_detail::compare_entries<Dictionary, Compare> compare_codes = { &dictionary, compare };
+    vergesort(order.begin(), order.end(), compare_codes);
+
+    std::vector<std::uint32_t> ranks(size);
+    for (std::size_t i = 0 ; i < size ; ++i)
+    {
+        ranks[order[i]] = std::uint32_t(i);
+    }
+    return ranks;
+}
+
+template<typename Dictionary>
+std::vector<std::uint32_t> vergesort_dictionary_ranks(const Dictionary& dictionary)
+{
+    typedef typename vergesort_detail::dictionary_compare<Dictionary>::type compare_type;
+    return vergesort_dictionary_ranks(dictionary, compare_type());
+}
+
+// Sorts codes referring to the entries of a dictionary (any collection of
+// strings with operator[] and size()) so that the entries they refer to are
+// in ascending order. The dictionary is sorted once, then the codes are
+// sorted as integers: with a counting sort when the dictionary is not
+// bigger than the collection of codes, with a radix sort on the ranks
+// otherwise. Equivalent entries with different codes end up next to each
+// other, in no particular order. Without compare, entries are compared with
+// std::less, or by their contents for C strings
+template<typename RandomAccessIterator, typename Dictionary, typename Compare>
+void vergesort_dictionary(RandomAccessIterator first, RandomAccessIterator last,
+                          const Dictionary& dictionary, Compare compare)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type code_type;
+    static_assert(std::is_integral<code_type>::value && std::is_unsigned<code_type>::value,
+                  "dictionary codes must be unsigned integers");
+
+    std::size_t size = std::distance(first, last);
+    if (size < 2) return;
+
+    std::size_t dictionary_size = dictionary.size();
+    std::vector<std::uint32_t> ranks = vergesort_dictionary_ranks(dictionary, compare);
+    std::vector<std::uint32_t> codes_by_rank(dictionary_size);
+    for (std::size_t code = 0 ; code < dictionary_size ; ++code)
+    {
+        codes_by_rank[ranks[code]] = std::uint32_t(code);
+    }
+
+    if (dictionary_size <= size)
+    {
+        // Count every code, then write them back in rank order
+        std::vector<std::size_t> counts(dictionary_size);
+        for (RandomAccessIterator it = first ; it != last ; ++it)
+        {
+            assert(std::size_t(*it) < dictionary_size && "code out of the dictionary");
+            ++counts[*it];
+        }
+        RandomAccessIterator out = first;
+        for (std::size_t rank = 0 ; rank < dictionary_size ; ++rank)
+        {
+            std::uint32_t code = codes_by_rank[rank];
+            out = std::fill_n(out, counts[code], code_type(code));
+        }
+        return;
+    }
+
+    // Huge dictionary: replace codes by their ranks, sort the ranks
+    // as integers, then map them back to codes
+    std::vector<std::uint32_t> sorted_ranks(size);
+    for (std::size_t i = 0 ; i < size ; ++i)
+    {
+        assert(std::size_t(first[i]) < dictionary_size && "code out of the dictionary");
+        sorted_ranks[i] = ranks[first[i]];
+    }
+    vergesort_detail::radix_sort(sorted_ranks.begin(), sorted_ranks.end());
+    for (std::size_t i = 0 ; i < size ; ++i)
+    {
+        first[i] = code_type(codes_by_rank[sorted_ranks[i]]);
+    }
+}
+
+template<typename RandomAccessIterator, typename Dictionary>
+void vergesort_dictionary(RandomAccessIterator first, RandomAccessIterator last,
+                          const Dictionary& dictionary)
+{
+    typedef typename vergesort_detail::dictionary_compare<Dictionary>::type compare_type;
+    vergesort_dictionary(first, last, dictionary, compare_type());
+}
+
+#endif // VERGESORT_DICTIONARY_H_
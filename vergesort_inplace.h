@@ -0,0 +1,352 @@
+/*
+ * vergesort_inplace.h - vergesort without any scratch memory
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_INPLACE_H_
+#define VERGESORT_INPLACE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+#include "pdqsort.h"
+#include "vergesort.h"
+
+namespace vergesort_detail
+{
+    enum {
+        // Size in bytes of the stack buffer used by the rotations
+        // and by the merges of small blocks
+        rotation_buffer_bytes = 1024
+    };
+
+    // Whether the elements of Iterator can be moved around with memcpy
+    // and memmove: trivially copyable values in contiguous memory
+    template<typename Iterator>
+    struct is_memmove_rotatable
+    {
+        typedef typename std::iterator_traits<Iterator>::value_type value_type;
+        static const bool value = std::is_trivially_copyable<value_type>::value
+                               && not std::is_same<value_type, bool>::value
+                               && (std::is_pointer<Iterator>::value
+                                   || std::is_same<Iterator, typename std::vector<value_type>::iterator>::value);
+    };
+
+    // Gries-Mills rotation: swaps the smaller block with the end of the
+    // bigger one that mirrors it, which puts it in its final place, then
+    // carries on with what remains. Only swaps contiguous blocks
+    template<typename RandomAccessIterator>
+    void block_swap_rotate(RandomAccessIterator first, RandomAccessIterator middle,
+                           RandomAccessIterator last)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+        difference_type left = middle - first;
+        difference_type right = last - middle;
+
+        while (left > 0 && right > 0)
+        {
+            if (left <= right)
+            {
+                std::swap_ranges(first, middle, middle);
+                first = middle;
+                middle += left;
+                right -= left;
+            }
+            else
+            {
+                std::swap_ranges(middle - right, middle, middle);
+                last = middle;
+                middle -= right;
+                left -= right;
+            }
+        }
+    }
+
+    // Rotation of trivially copyable values, in the spirit of the trinity
+    // rotation: when the smaller block fits in a stack buffer, it is put
+    // aside while the bigger one is moved with memmove; when both blocks
+    // have almost the same size, only their difference is put aside and
+    // every other element is moved exactly once (bridge rotation);
+    // otherwise it falls back to the block-swap rotation
+    template<typename T>
+    void memmove_rotate(T* first, T* middle, T* last)
+    {
+        std::size_t left = middle - first;
+        std::size_t right = last - middle;
+        const std::size_t capacity = rotation_buffer_bytes / sizeof(T);
+        alignas(T) unsigned char storage[rotation_buffer_bytes];
+        T* buffer = reinterpret_cast<T*>(storage);
+
+        if (left <= right && left <= capacity)
+        {
+            std::memcpy(buffer, first, left * sizeof(T));
+            std::memmove(first, middle, right * sizeof(T));
+            std::memcpy(first + right, buffer, left * sizeof(T));
+        }
+        else if (right <= capacity)
+        {
+            std::memcpy(buffer, middle, right * sizeof(T));
+            std::memmove(first + right, first, left * sizeof(T));
+            std::memcpy(first, buffer, right * sizeof(T));
+        }
+        else if (left > right && left - right <= capacity)
+        {
+            // The end of the left block goes to the buffer, then every
+            // element of the right block takes the place of an element
+            // of the left block, which moves to the hole left behind
+            std::size_t bridge = left - right;
+            std::memcpy(buffer, first + right, bridge * sizeof(T));
+            for (std::size_t i = 0 ; i < right ; ++i)
+            {
+                first[right + i] = first[i];
+                first[i] = middle[i];
+            }
+            std::memcpy(first + 2 * right, buffer, bridge * sizeof(T));
+        }
+        else if (right > left && right - left <= capacity)
+        {
+            // Same as above, from the end
+            std::size_t bridge = right - left;
+            std::memcpy(buffer, middle, bridge * sizeof(T));
+            for (std::size_t i = 0 ; i < left ; ++i)
+            {
+                last[-1 - std::ptrdiff_t(left + i)] = last[-1 - std::ptrdiff_t(i)];
+                last[-1 - std::ptrdiff_t(i)] = middle[-1 - std::ptrdiff_t(i)];
+            }
+            std::memcpy(first, buffer, bridge * sizeof(T));
+        }
+        else
+        {
+            block_swap_rotate(first, middle, last);
+        }
+    }
+
+    template<typename RandomAccessIterator>
+    void rotate(RandomAccessIterator first, RandomAccessIterator middle,
+                RandomAccessIterator last, std::false_type)
+    {
+        block_swap_rotate(first, middle, last);
+    }
+
+    template<typename RandomAccessIterator>
+    void rotate(RandomAccessIterator first, RandomAccessIterator middle,
+                RandomAccessIterator last, std::true_type)
+    {
+        if (first == middle || middle == last) return;
+        memmove_rotate(&*first, &*first + (middle - first), &*first + (last - first));
+    }
+
+    // Same as std::rotate, without the returned iterator
+    template<typename RandomAccessIterator>
+    void rotate(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last)
+    {
+        rotate(first, middle, last,
+               std::integral_constant<bool, is_memmove_rotatable<RandomAccessIterator>::value>());
+    }
+
+    template<typename RandomAccessIterator, typename Compare>
+    bool small_merge(RandomAccessIterator, RandomAccessIterator, RandomAccessIterator,
+                     Compare, std::false_type)
+    {
+        return false;
+    }
+
+    // Stable merge through the stack buffer when the smaller block fits
+    // in it, returns false when it does not
+    template<typename RandomAccessIterator, typename Compare>
+    bool small_merge(RandomAccessIterator first, RandomAccessIterator middle,
+                     RandomAccessIterator last, Compare compare, std::true_type)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+        const std::size_t capacity = rotation_buffer_bytes / sizeof(value_type);
+        alignas(value_type) unsigned char storage[rotation_buffer_bytes];
+        value_type* buffer = reinterpret_cast<value_type*>(storage);
+
+        std::size_t left = middle - first;
+        std::size_t right = last - middle;
+        if (left <= right && left <= capacity)
+        {
+            std::memcpy(buffer, &*first, left * sizeof(value_type));
+            value_type* it = buffer;
+            value_type* end = buffer + left;
+            while (it != end && middle != last)
+            {
+                if (compare(*middle, *it)) *first++ = *middle++;
+                else *first++ = *it++;
+            }
+            std::memcpy(&*first, it, (end - it) * sizeof(value_type));
+            return true;
+        }
+        if (right <= capacity)
+        {
+            std::memcpy(buffer, &*middle, right * sizeof(value_type));
+            value_type* it = buffer + right;
+            while (it != buffer && middle != first)
+            {
+                if (compare(it[-1], middle[-1])) *--last = *--middle;
+                else *--last = *--it;
+            }
+            std::memcpy(&*first, buffer, (it - buffer) * sizeof(value_type));
+            return true;
+        }
+        return false;
+    }
+
+    // Bounds of the two independent merges that a merge of [first, middle)
+    // and [middle, last) splits into once the blocks [first + start, middle)
+    // and [middle, first + end) are swapped: [first, first + start) with
+    // [first + start, first + half), and [first + half, first + end) with
+    // [first + end, last)
+    template<typename RandomAccessIterator>
+    struct merge_split
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+
+        difference_type start;
+        difference_type half;
+        difference_type end;
+    };
+
+    // The split of SymMerge (Kim & Kutzner): the merged sequence is cut in
+    // its middle, and a binary search finds which blocks of both halves
+    // cross that middle
+    template<typename RandomAccessIterator, typename Compare>
+    merge_split<RandomAccessIterator> symmerge_split(RandomAccessIterator first, RandomAccessIterator middle,
+                                                     RandomAccessIterator last, Compare compare)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+
+        difference_type size = last - first;
+        difference_type left = middle - first;
+        difference_type half = size / 2;
+        difference_type sum = half + left;
+
+        difference_type start, end;
+        if (left > half)
+        {
+            start = sum - size;
+            end = half;
+        }
+        else
+        {
+            start = 0;
+            end = left;
+        }
+        while (start < end)
+        {
+            difference_type probe = start + (end - start) / 2;
+            if (not compare(first[sum - 1 - probe], first[probe])) start = probe + 1;
+            else end = probe;
+        }
+
+        merge_split<RandomAccessIterator> split = { start, half, sum - start };
+        return split;
+    }
+
+    // SymMerge: stable merge of [first, middle) and [middle, last) without
+    // any heap memory. The blocks found by symmerge_split are swapped with
+    // one rotation, then both sides are merged recursively. Small blocks
+    // are merged with a stack buffer instead when the values can be copied
+    // with memcpy
+    template<typename RandomAccessIterator, typename Compare>
+    void symmerge(RandomAccessIterator first, RandomAccessIterator middle,
+                  RandomAccessIterator last, Compare compare)
+    {
+        if (first == middle || middle == last) return;
+        if (not compare(*middle, *(middle - 1))) return;
+
+        if (small_merge(first, middle, last, compare,
+                        std::integral_constant<bool, is_memmove_rotatable<RandomAccessIterator>::value>()))
+        {
+            return;
+        }
+
+        if (middle - first == 1)
+        {
+            RandomAccessIterator position = std::lower_bound(middle, last, *first, compare);
+            vergesort_detail::rotate(first, middle, position);
+            return;
+        }
+        if (last - middle == 1)
+        {
+            RandomAccessIterator position = std::upper_bound(first, middle, *middle, compare);
+            vergesort_detail::rotate(position, middle, last);
+            return;
+        }
+
+        merge_split<RandomAccessIterator> split = symmerge_split(first, middle, last, compare);
+        vergesort_detail::rotate(first + split.start, middle, first + split.end);
+        symmerge(first, first + split.start, first + split.half, compare);
+        symmerge(first + split.half, first + split.end, last, compare);
+    }
+
+    // Merge function for the random-access vergesort that does not
+    // allocate any memory
+    struct unbuffered_merge
+    {
+        template<typename RandomAccessIterator, typename Compare>
+        void operator()(RandomAccessIterator first, RandomAccessIterator middle,
+                        RandomAccessIterator last, Compare compare) const
+        {
+            symmerge(first, middle, last, compare);
+        }
+    };
+}
+
+// Same as vergesort for random-access iterators, but runs are merged with
+// an unbuffered merge instead of std::inplace_merge, so that no memory is
+// ever allocated. When std::inplace_merge fails to get a buffer, it falls
+// back to a recursive merge built on std::rotate: this one relies on rotations
+// that move trivially copyable values with memmove through a small stack
+// buffer, and merges small blocks through that buffer as well
+template<typename RandomAccessIterator, typename Compare>
+void vergesort_inplace(RandomAccessIterator first, RandomAccessIterator last, Compare compare)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+    difference_type dist = last - first;
+
+    if (dist < 80)
+    {
+        // Small collections never reach the merges
+        vergesort(first, last, compare);
+        return;
+    }
+
+    difference_type unstable_limit = dist / pdqsort_detail::log2(dist);
+    vergesort_detail::vergesort(first, last, compare, unstable_limit,
+                                static_cast<vergesort_detail::vergesort_stats*>(0),
+                                vergesort_detail::unbuffered_merge());
+}
+
+template<typename RandomAccessIterator>
+void vergesort_inplace(RandomAccessIterator first, RandomAccessIterator last)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+    vergesort_inplace(first, last, std::less<value_type>());
+}
+
+#endif // VERGESORT_INPLACE_H_
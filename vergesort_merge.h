@@ -0,0 +1,317 @@
+/*
+ * vergesort_merge.h - merging several sorted collections
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_MERGE_H_
+#define VERGESORT_MERGE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "parallel_vergesort.h"
+
+namespace vergesort_detail
+{
+    // Tournament tree of losers over k sorted sources: the root holds
+    // the source whose current element comes first, and replacing it
+    // only replays the matches on the path from its leaf to the root,
+    // which is log k comparisons. Ties go to the source with the lowest
+    // index, which makes the merge stable
+    template<typename Iterator, typename Compare>
+    class loser_tree
+    {
+        public:
+
+            loser_tree(const std::vector<std::pair<Iterator, Iterator> >& sources, Compare compare):
+                sources_(sources),
+                compare_(compare)
+            {
+                leaves_ = 1;
+                while (leaves_ < sources_.size()) leaves_ *= 2;
+                tree_.resize(leaves_);
+
+                // Winners of the matches, only needed to build the tree
+                std::vector<std::size_t> winners(2 * leaves_);
+                for (std::size_t i = 0 ; i < leaves_ ; ++i)
+                {
+                    winners[leaves_ + i] = i;
+                }
+                for (std::size_t node = leaves_ - 1 ; node > 0 ; --node)
+                {
+                    std::size_t lhs = winners[2 * node];
+                    std::size_t rhs = winners[2 * node + 1];
+                    if (beats(rhs, lhs)) std::swap(lhs, rhs);
+                    winners[node] = lhs;
+                    tree_[node] = rhs;
+                }
+                tree_[0] = winners[1];
+            }
+
+            bool empty() const
+            {
+                return exhausted(tree_[0]);
+            }
+
+            Iterator top() const
+            {
+                return sources_[tree_[0]].first;
+            }
+
+            // Moves past the current first element
+            void pop()
+            {
+                std::size_t winner = tree_[0];
+                ++sources_[winner].first;
+                for (std::size_t node = (leaves_ + winner) / 2 ; node > 0 ; node /= 2)
+                {
+                    if (beats(tree_[node], winner)) std::swap(tree_[node], winner);
+                }
+                tree_[0] = winner;
+            }
+
+        private:
+
+            bool exhausted(std::size_t source) const
+            {
+                return source >= sources_.size() || sources_[source].first == sources_[source].second;
+            }
+
+            bool beats(std::size_t lhs, std::size_t rhs) const
+            {
+                if (exhausted(lhs)) return false;
+                if (exhausted(rhs)) return true;
+                if (compare_(*sources_[rhs].first, *sources_[lhs].first)) return false;
+                if (compare_(*sources_[lhs].first, *sources_[rhs].first)) return true;
+                return lhs < rhs;
+            }
+
+            std::vector<std::pair<Iterator, Iterator> > sources_;
+            Compare compare_;
+            std::size_t leaves_;
+            std::vector<std::size_t> tree_;
+    };
+
+    template<typename Iterator, typename OutputIterator, typename Compare>
+    OutputIterator sequential_merge_k(const std::vector<std::pair<Iterator, Iterator> >& sources,
+                                      OutputIterator out, Compare compare)
+    {
+        if (sources.empty()) return out;
+        if (sources.size() == 1)
+        {
+            return std::copy(sources[0].first, sources[0].second, out);
+        }
+        if (sources.size() == 2)
+        {
+            return std::merge(sources[0].first, sources[0].second,
+                              sources[1].first, sources[1].second,
+                              out, compare);
+        }
+
+        loser_tree<Iterator, Compare> tree(sources, compare);
+        for (; not tree.empty() ; tree.pop())
+        {
+            *out = *tree.top();
+            ++out;
+        }
+        return out;
+    }
+
+    // Multiway merge partitioning: finds how many elements of every source
+    // come before the rank-th element of the merged output, ties being
+    // ordered by source. Every step picks the middle of the largest
+    // remaining window as a pivot, computes its rank with a binary search
+    // in every source, and shrinks all the windows accordingly
+    template<typename Iterator, typename Compare>
+    std::vector<std::size_t> multiway_split(const std::vector<std::pair<Iterator, Iterator> >& sources,
+                                            std::size_t rank, Compare compare)
+    {
+        std::size_t k = sources.size();
+        std::vector<std::size_t> low(k, 0);
+        std::vector<std::size_t> high(k);
+        std::vector<std::size_t> counts(k);
+        for (std::size_t i = 0 ; i < k ; ++i)
+        {
+            high[i] = std::distance(sources[i].first, sources[i].second);
+        }
+
+        while (true)
+        {
+            std::size_t pivot_source = k;
+            std::size_t largest = 0;
+            for (std::size_t i = 0 ; i < k ; ++i)
+            {
+                if (high[i] - low[i] > largest)
+                {
+                    largest = high[i] - low[i];
+                    pivot_source = i;
+                }
+            }
+            if (pivot_source == k) return low;
+
+            std::size_t pivot_pos = low[pivot_source] + largest / 2;
+            Iterator pivot = sources[pivot_source].first + pivot_pos;
+
+            // Number of elements of every source ordered before the pivot
+            std::size_t pivot_rank = 0;
+            for (std::size_t i = 0 ; i < k ; ++i)
+            {
+                Iterator begin = sources[i].first;
+                if (i < pivot_source)
+                {
+                    counts[i] = std::upper_bound(begin + low[i], begin + high[i], *pivot, compare) - begin;
+                }
+                else if (i > pivot_source)
+                {
+                    counts[i] = std::lower_bound(begin + low[i], begin + high[i], *pivot, compare) - begin;
+                }
+                else
+                {
+                    counts[i] = pivot_pos;
+                }
+                pivot_rank += counts[i];
+            }
+
+            if (pivot_rank < rank)
+            {
+                // The pivot and everything before it are in the first
+                // rank elements
+                for (std::size_t i = 0 ; i < k ; ++i)
+                {
+                    low[i] = counts[i];
+                }
+                low[pivot_source] = pivot_pos + 1;
+            }
+            else
+            {
+                for (std::size_t i = 0 ; i < k ; ++i)
+                {
+                    high[i] = counts[i];
+                }
+            }
+        }
+    }
+
+    template<typename Iterator, typename RandomAccessIterator, typename Compare>
+    void merge_k_slice(const std::vector<std::pair<Iterator, Iterator> >* sources,
+                       std::size_t first_rank, std::size_t last_rank,
+                       RandomAccessIterator out, Compare compare)
+    {
+        std::vector<std::size_t> begins = multiway_split(*sources, first_rank, compare);
+        std::vector<std::size_t> ends = multiway_split(*sources, last_rank, compare);
+
+        std::vector<std::pair<Iterator, Iterator> > slices;
+        for (std::size_t i = 0 ; i < sources->size() ; ++i)
+        {
+            if (begins[i] == ends[i]) continue;
+            Iterator begin = (*sources)[i].first;
+            slices.push_back(std::make_pair(begin + begins[i], begin + ends[i]));
+        }
+        sequential_merge_k(slices, out + first_rank, compare);
+    }
+
+    template<typename Iterator, typename OutputIterator, typename Compare>
+    OutputIterator merge_k(const std::vector<std::pair<Iterator, Iterator> >& sources,
+                           OutputIterator out, Compare compare, unsigned,
+                           std::false_type)
+    {
+        return sequential_merge_k(sources, out, compare);
+    }
+
+    template<typename Iterator, typename RandomAccessIterator, typename Compare>
+    RandomAccessIterator merge_k(const std::vector<std::pair<Iterator, Iterator> >& sources,
+                                 RandomAccessIterator out, Compare compare, unsigned threads,
+                                 std::true_type)
+    {
+        std::size_t total = 0;
+        for (std::size_t i = 0 ; i < sources.size() ; ++i)
+        {
+            total += std::distance(sources[i].first, sources[i].second);
+        }
+
+        std::size_t slices = std::min<std::size_t>(threads, total / parallel_grain_size);
+        if (slices < 2)
+        {
+            return sequential_merge_k(sources, out, compare);
+        }
+
+        // Every thread finds its own slice of the output and of the
+        // sources, then merges it independently from the others
+        std::vector<std::thread> workers;
+        for (std::size_t i = 1 ; i < slices ; ++i)
+        {
+            workers.emplace_back(
+                merge_k_slice<Iterator, RandomAccessIterator, Compare>,
+                &sources, total / slices * i, i + 1 == slices ? total : total / slices * (i + 1),
+                out, compare
+            );
+        }
+        merge_k_slice(&sources, 0, total / slices, out, compare);
+        for (std::thread& worker: workers) worker.join();
+        return out + total;
+    }
+}
+
+// Merges several sorted collections (any collection of containers with
+// random-access iterators) into out, stable with respect to the order of
+// the collections. When out is a random-access iterator and the output is
+// big enough, the output is cut into one slice per thread with a multiway
+// partitioning of the inputs, and the slices are merged concurrently.
+// Returns the end of the output
+template<typename Ranges, typename OutputIterator, typename Compare>
+OutputIterator vergesort_merge_k(const Ranges& ranges, OutputIterator out,
+                                 Compare compare, unsigned threads)
+{
+    typedef typename Ranges::value_type range_type;
+    typedef typename range_type::const_iterator iterator;
+    typedef typename std::iterator_traits<OutputIterator>::iterator_category category;
+
+    std::vector<std::pair<iterator, iterator> > sources;
+    for (typename Ranges::const_iterator it = ranges.begin() ; it != ranges.end() ; ++it)
+    {
+        if (it->begin() == it->end()) continue;
+        sources.push_back(std::make_pair(it->begin(), it->end()));
+    }
+    return vergesort_detail::merge_k(sources, out, compare, threads,
+                                     std::is_base_of<std::random_access_iterator_tag, category>());
+}
+
+template<typename Ranges, typename OutputIterator, typename Compare>
+OutputIterator vergesort_merge_k(const Ranges& ranges, OutputIterator out, Compare compare)
+{
+    return vergesort_merge_k(ranges, out, compare, vergesort_detail::default_thread_count());
+}
+
+template<typename Ranges, typename OutputIterator>
+OutputIterator vergesort_merge_k(const Ranges& ranges, OutputIterator out)
+{
+    typedef typename Ranges::value_type::value_type value_type;
+    return vergesort_merge_k(ranges, out, std::less<value_type>());
+}
+
+#endif // VERGESORT_MERGE_H_
@@ -0,0 +1,277 @@
+/*
+ * vergesort_packed.h - sorting bit-packed unsigned integers
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_PACKED_H_
+#define VERGESORT_PACKED_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vergesort.h"
+
+// Packed arrays store size values of bits bits each (1 to 32) as a
+// little-endian bit stream: value i occupies bits [i * bits, (i + 1) * bits)
+// of an array of 64-bit words, bit 0 being the least significant bit of
+// the first word. Bits past the last value are left untouched.
+
+namespace vergesort_detail
+{
+    enum {
+        // Number of values unpacked at once into a local buffer
+        packed_block_size = 256,
+
+        // Maximum number of bits of a radix digit, so that the
+        // histogram stays in L1 cache
+        packed_max_digit_bits = 11,
+
+        // Data with fewer descents than size / packed_runs_ratio is
+        // unpacked and sorted with vergesort instead
+        packed_runs_ratio = 64
+    };
+
+    // Number of 64-bit words needed to store size values of bits bits
+    inline std::size_t packed_words(std::size_t size, unsigned bits)
+    {
+        return (size * bits + 63) / 64;
+    }
+
+    // Writes a value at index in words where those bits are known
+    // to be zero
+    inline void packed_or(std::uint64_t* words, std::size_t index, unsigned bits, std::uint32_t value)
+    {
+        std::size_t pos = index * bits;
+        std::size_t word = pos / 64;
+        unsigned offset = pos % 64;
+        words[word] |= std::uint64_t(value) << offset;
+        if (offset + bits > 64) words[word + 1] |= std::uint64_t(value) >> (64 - offset);
+    }
+
+    // Unpacks count values starting at index first; the loop has no
+    // data-dependent branch so that it can be vectorized
+    inline void unpack_block(const std::uint64_t* words, std::size_t first, std::size_t count,
+                             unsigned bits, std::uint32_t* out)
+    {
+        const std::uint64_t mask = (std::uint64_t(1) << bits) - 1;
+        for (std::size_t i = 0 ; i < count ; ++i)
+        {
+            std::size_t pos = (first + i) * bits;
+            std::size_t word = pos / 64;
+            unsigned offset = pos % 64;
+            std::uint64_t low = words[word] >> offset;
+            // Read the next word only when the value straddles it,
+            // without reading past the end of the array
+            std::size_t next = word + (offset + bits > 64);
+            std::uint64_t high = (words[next] << 1) << (63 - offset);
+            out[i] = std::uint32_t((low | (offset + bits > 64 ? high : 0)) & mask);
+        }
+    }
+
+    // Packs values into words, overwriting the bits of the values
+    // [first, first + count) and nothing else
+    inline void pack_range(const std::uint32_t* values, std::size_t first, std::size_t count,
+                           unsigned bits, std::uint64_t* words)
+    {
+        const std::uint64_t mask = (std::uint64_t(1) << bits) - 1;
+        for (std::size_t i = 0 ; i < count ; ++i)
+        {
+            std::size_t pos = (first + i) * bits;
+            std::size_t word = pos / 64;
+            unsigned offset = pos % 64;
+            words[word] = (words[word] & ~(mask << offset)) | (std::uint64_t(values[i]) << offset);
+            if (offset + bits > 64)
+            {
+                unsigned spill = offset + bits - 64;
+                std::uint64_t spill_mask = (std::uint64_t(1) << spill) - 1;
+                words[word + 1] = (words[word + 1] & ~spill_mask) | (std::uint64_t(values[i]) >> (64 - offset));
+            }
+        }
+    }
+
+    // What a single pass over the packed values found
+    struct packed_scan
+    {
+        std::size_t descents;
+        std::size_t ascents;
+    };
+
+    // Histogram of the radix digit at shift, counting ascents and
+    // descents on the way when scan is not null
+    inline void packed_histogram(const std::uint64_t* words, std::size_t size, unsigned bits,
+                                 unsigned shift, unsigned digit_mask, std::size_t* counts,
+                                 packed_scan* scan)
+    {
+        std::uint32_t block[packed_block_size];
+        std::uint32_t previous = 0;
+        for (std::size_t first = 0 ; first < size ; first += packed_block_size)
+        {
+            std::size_t count = std::min<std::size_t>(packed_block_size, size - first);
+            unpack_block(words, first, count, bits, block);
+            for (std::size_t i = 0 ; i < count ; ++i)
+            {
+                ++counts[(block[i] >> shift) & digit_mask];
+            }
+            if (scan)
+            {
+                if (first != 0)
+                {
+                    scan->descents += block[0] < previous;
+                    scan->ascents += previous < block[0];
+                }
+                for (std::size_t i = 1 ; i < count ; ++i)
+                {
+                    scan->descents += block[i] < block[i - 1];
+                    scan->ascents += block[i - 1] < block[i];
+                }
+                previous = block[count - 1];
+            }
+        }
+    }
+
+    // Unpacks everything, sorts it with vergesort and packs it back
+    inline void packed_vergesort(std::uint64_t* words, std::size_t size, unsigned bits)
+    {
+        std::vector<std::uint32_t> values(size);
+        unpack_block(words, 0, size, bits, values.data());
+        ::vergesort(values.begin(), values.end());
+        pack_range(values.data(), 0, size, bits, words);
+    }
+
+    // LSD radix sort working directly on the packed representation: every
+    // pass reads and writes size * bits bits instead of size * 32
+    inline void packed_radix_sort(std::uint64_t* words, std::size_t size, unsigned bits,
+                                  std::size_t* first_counts, unsigned digit_bits)
+    {
+        std::size_t nb_words = packed_words(size, bits);
+        std::vector<std::uint64_t> buffer(nb_words);
+        std::uint64_t* src = words;
+        std::uint64_t* dst = buffer.data();
+
+        // Bits of the last word past the end of the values
+        unsigned tail_bits = (size * bits) % 64;
+        std::uint64_t tail = tail_bits ? words[nb_words - 1] & ~((std::uint64_t(1) << tail_bits) - 1) : 0;
+
+        unsigned digit_mask = (1u << digit_bits) - 1;
+        std::vector<std::size_t> counts(std::size_t(1) << digit_bits);
+        std::uint32_t block[packed_block_size];
+
+        for (unsigned shift = 0 ; shift < bits ; shift += digit_bits)
+        {
+            // The histogram of the first digit comes with the scan
+            if (shift == 0)
+            {
+                std::copy(first_counts, first_counts + counts.size(), counts.begin());
+            }
+            else
+            {
+                std::fill(counts.begin(), counts.end(), 0);
+                packed_histogram(src, size, bits, shift, digit_mask, counts.data(), 0);
+            }
+
+            // Every value has the same digit
+            if (std::find(counts.begin(), counts.end(), size) != counts.end()) continue;
+
+            std::size_t offset = 0;
+            for (std::size_t& count: counts)
+            {
+                std::size_t tmp = count;
+                count = offset;
+                offset += tmp;
+            }
+
+            std::fill(dst, dst + nb_words, 0);
+            for (std::size_t first = 0 ; first < size ; first += packed_block_size)
+            {
+                std::size_t count = std::min<std::size_t>(packed_block_size, size - first);
+                unpack_block(src, first, count, bits, block);
+                for (std::size_t i = 0 ; i < count ; ++i)
+                {
+                    packed_or(dst, counts[(block[i] >> shift) & digit_mask]++, bits, block[i]);
+                }
+            }
+            std::swap(src, dst);
+        }
+
+        if (src != words)
+        {
+            std::copy(src, src + nb_words, words);
+        }
+        if (tail_bits)
+        {
+            words[nb_words - 1] = (words[nb_words - 1] & ((std::uint64_t(1) << tail_bits) - 1)) | tail;
+        }
+    }
+}
+
+// Sorts size bit-packed values of bits bits in ascending order. The first
+// radix pass also finds how sorted the data is: already sorted data is left
+// as is, descending data is reversed, data made of a few runs is unpacked
+// and handed to vergesort, everything else is radix sorted in packed form
+inline void vergesort_packed(std::uint64_t* words, std::size_t size, unsigned bits)
+{
+    if (size < 2 || bits == 0) return;
+
+    unsigned passes = (bits + vergesort_detail::packed_max_digit_bits - 1)
+                    / vergesort_detail::packed_max_digit_bits;
+    unsigned digit_bits = (bits + passes - 1) / passes;
+
+    std::vector<std::size_t> counts(std::size_t(1) << digit_bits);
+    vergesort_detail::packed_scan scan = { 0, 0 };
+    vergesort_detail::packed_histogram(words, size, bits, 0, (1u << digit_bits) - 1,
+                                       counts.data(), &scan);
+
+    if (scan.descents == 0) return;
+    if (scan.ascents == 0)
+    {
+        // Non-ascending data only needs to be reversed
+        std::vector<std::uint32_t> values(size);
+        vergesort_detail::unpack_block(words, 0, size, bits, values.data());
+        std::reverse(values.begin(), values.end());
+        vergesort_detail::pack_range(values.data(), 0, size, bits, words);
+        return;
+    }
+    if (scan.descents < size / vergesort_detail::packed_runs_ratio)
+    {
+        vergesort_detail::packed_vergesort(words, size, bits);
+        return;
+    }
+    vergesort_detail::packed_radix_sort(words, size, bits, counts.data(), digit_bits);
+}
+
+// Packs size values of bits bits into words, which must hold at least
+// vergesort_detail::packed_words(size, bits) words
+inline void vergesort_pack(const std::uint32_t* values, std::size_t size, unsigned bits,
+                           std::uint64_t* words)
+{
+    vergesort_detail::pack_range(values, 0, size, bits, words);
+}
+
+inline void vergesort_unpack(const std::uint64_t* words, std::size_t size, unsigned bits,
+                             std::uint32_t* values)
+{
+    vergesort_detail::unpack_block(words, 0, size, bits, values);
+}
+
+#endif // VERGESORT_PACKED_H_
@@ -0,0 +1,118 @@
+/*
+ * vergesort_radix.h - LSD radix sort shared by the integer fast paths
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_RADIX_H_
+#define VERGESORT_RADIX_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace vergesort_detail
+{
+    // Whether radix_sort can replace a comparison sort
+    template<typename T, typename Compare>
+    struct is_radix_sortable:
+        std::integral_constant<bool,
+            std::is_integral<T>::value &&
+            not std::is_same<T, bool>::value &&
+            std::is_same<Compare, std::less<T> >::value
+        >
+    {};
+
+    // One pass of radix_sort: scatters [src, src + size) to dst by the
+    // byte at shift, returns false without moving anything when every
+    // element has the same byte
+    template<typename Source, typename Destination, typename UnsignedType>
+    bool radix_pass(Source src, Destination dst, std::size_t size,
+                    std::size_t shift, UnsignedType flip)
+    {
+        std::size_t counts[256] = {};
+        for (std::size_t i = 0 ; i < size ; ++i)
+        {
+            ++counts[((UnsignedType(src[i]) ^ flip) >> shift) & 0xff];
+        }
+        if (counts[((UnsignedType(src[0]) ^ flip) >> shift) & 0xff] == size) return false;
+
+        std::size_t offset = 0;
+        for (std::size_t& count: counts)
+        {
+            std::size_t tmp = count;
+            count = offset;
+            offset += tmp;
+        }
+        for (std::size_t i = 0 ; i < size ; ++i)
+        {
+            dst[counts[((UnsignedType(src[i]) ^ flip) >> shift) & 0xff]++] = src[i];
+        }
+        return true;
+    }
+
+    // LSD radix sort on bytes for integers in ascending order; passes
+    // where every element has the same byte are skipped. The passes go
+    // back and forth between the collection and a single buffer
+    template<typename RandomAccessIterator>
+    void radix_sort(RandomAccessIterator first, RandomAccessIterator last)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+        typedef typename std::make_unsigned<value_type>::type unsigned_type;
+
+        std::size_t size = std::distance(first, last);
+        if (size < 2) return;
+
+        // Flipping the sign bit maps signed integers to unsigned ones
+        // in the same order
+        const unsigned_type flip = std::is_signed<value_type>::value
+            ? unsigned_type(1) << (std::numeric_limits<unsigned_type>::digits - 1)
+            : unsigned_type(0);
+
+        std::vector<value_type> buffer(size);
+        bool in_buffer = false;
+        for (std::size_t shift = 0 ; shift < sizeof(value_type) * 8 ; shift += 8)
+        {
+            bool moved = in_buffer ? radix_pass(buffer.data(), first, size, shift, flip)
+                                   : radix_pass(first, buffer.data(), size, shift, flip);
+            if (moved) in_buffer = not in_buffer;
+        }
+
+        if (in_buffer) std::copy(buffer.begin(), buffer.end(), first);
+    }
+
+    template<typename RandomAccessIterator>
+    void radix_sort_if_possible(RandomAccessIterator first, RandomAccessIterator last, std::true_type)
+    {
+        radix_sort(first, last);
+    }
+
+    template<typename RandomAccessIterator>
+    void radix_sort_if_possible(RandomAccessIterator, RandomAccessIterator, std::false_type)
+    {}
+}
+
+#endif // VERGESORT_RADIX_H_
@@ -0,0 +1,172 @@
+/*
+ * vergesort_reorder.h - reordering nearly sorted event streams
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_REORDER_H_
+#define VERGESORT_REORDER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "vergesort.h"
+
+// Reorder buffer for streams of events that arrive out of order, but not
+// later than a bounded lateness: events are collected as they come, and
+// release(watermark) hands out, in order, every event that compares less
+// than the watermark. Newly arrived events are sorted with vergesort, which
+// is cheap since they are nearly sorted, then merged into the run of pending
+// events; only the end of that run can overlap the new events, so merges
+// stay proportional to the lateness rather than to the number of pending
+// events. Events that arrive after a watermark they should have been
+// released by come out at the beginning of the next release
+template<typename T, typename Compare = std::less<T> >
+class verge_reorder_buffer
+{
+    public:
+
+        typedef typename std::vector<T>::const_iterator const_iterator;
+
+        // Events released by a call to release, stored in the buffer
+        // itself: valid until the next call to release, flush or clear
+        class range
+        {
+            public:
+
+                range(const_iterator first, const_iterator last):
+                    first_(first),
+                    last_(last)
+                {}
+
+                const_iterator begin() const { return first_; }
+                const_iterator end() const { return last_; }
+                std::size_t size() const { return last_ - first_; }
+                bool empty() const { return first_ == last_; }
+
+            private:
+
+                const_iterator first_;
+                const_iterator last_;
+        };
+
+        explicit verge_reorder_buffer(Compare compare = Compare()):
+            compare_(compare),
+            released_(0)
+        {}
+
+        void push(const T& value)
+        {
+            incoming_.push_back(value);
+        }
+
+        template<typename InputIterator>
+        void push(InputIterator first, InputIterator last)
+        {
+            incoming_.insert(incoming_.end(), first, last);
+        }
+
+        // Releases, in order, every event that compares less than the
+        // watermark
+        range release(const T& watermark)
+        {
+            absorb();
+            typename std::vector<T>::iterator first = pending_.begin() + released_;
+            typename std::vector<T>::iterator last = std::lower_bound(first, pending_.end(),
+                                                                      watermark, compare_);
+            released_ = last - pending_.begin();
+            return range(first, last);
+        }
+
+        // Releases every event, for the end of a stream
+        range flush()
+        {
+            absorb();
+            typename std::vector<T>::iterator first = pending_.begin() + released_;
+            released_ = pending_.size();
+            return range(first, pending_.end());
+        }
+
+        // Number of events not released yet
+        std::size_t size() const
+        {
+            return pending_.size() - released_ + incoming_.size();
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        void clear()
+        {
+            pending_.clear();
+            incoming_.clear();
+            released_ = 0;
+        }
+
+    private:
+
+        // Drops the released events, then sorts the events that arrived
+        // since the last release and merges them into the pending run
+        void absorb()
+        {
+            // Moving the pending events down is amortized over the
+            // events released since the last time
+            if (released_ > 0 && released_ >= pending_.size() - released_)
+            {
+                pending_.erase(pending_.begin(), pending_.begin() + released_);
+                released_ = 0;
+            }
+
+            if (incoming_.empty()) return;
+            vergesort(incoming_.begin(), incoming_.end(), compare_);
+
+            std::size_t old_size = pending_.size();
+            pending_.insert(pending_.end(), incoming_.begin(), incoming_.end());
+            incoming_.clear();
+
+            typename std::vector<T>::iterator middle = pending_.begin() + old_size;
+            if (old_size > released_ && compare_(*middle, *(middle - 1)))
+            {
+                // Only merge the pending events that come after the
+                // first new one
+                typename std::vector<T>::iterator overlap = std::upper_bound(
+                    pending_.begin() + released_, middle, *middle, compare_
+                );
+                std::inplace_merge(overlap, middle, pending_.end(), compare_);
+            }
+        }
+
+        Compare compare_;
+
+        // Sorted run of events, the first released_ of which have
+        // already been handed out
+        std::vector<T> pending_;
+        std::size_t released_;
+
+        // Events pushed since the last release, in arrival order
+        std::vector<T> incoming_;
+};
+
+#endif // VERGESORT_REORDER_H_
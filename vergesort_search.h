@@ -0,0 +1,95 @@
+/*
+ * vergesort_search.h - batched searches in sorted collections
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_SEARCH_H_
+#define VERGESORT_SEARCH_H_
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "vergesort.h"
+#include "vergesort_set.h"
+
+namespace vergesort_detail
+{
+    // Orders (query, position) pairs by query only
+    template<typename Pair, typename Compare>
+    struct compare_queries
+    {
+        Compare compare;
+
+        bool operator()(const Pair& lhs, const Pair& rhs) const
+        {
+            return compare(lhs.first, rhs.first);
+        }
+    };
+}
+
+// Equivalent to out[i] = std::lower_bound(first, last, queries_first[i], compare)
+// for every query, but the queries are first sorted with vergesort (cheap when
+// they are almost sorted already, which is often the case), then all answered
+// in a single pass through [first, last) that gallops from one answer to the
+// next: the collection is read sequentially instead of with a binary search
+// per query, and close queries cost a handful of comparisons. out must be
+// a random-access iterator to a collection of RandomAccessIterator
+template<typename RandomAccessIterator, typename QueryIterator,
+         typename ResultIterator, typename Compare>
+void batch_lower_bound(RandomAccessIterator first, RandomAccessIterator last,
+                       QueryIterator queries_first, QueryIterator queries_last,
+                       ResultIterator out, Compare compare)
+{
+    typedef typename std::iterator_traits<QueryIterator>::value_type query_type;
+    typedef std::pair<query_type, std::size_t> pair_type;
+
+    std::vector<pair_type> queries;
+    queries.reserve(std::distance(queries_first, queries_last));
+    for (std::size_t i = 0 ; queries_first != queries_last ; ++queries_first, ++i)
+    {
+        queries.push_back(pair_type(*queries_first, i));
+    }
+
+    vergesort_detail::compare_queries<pair_type, Compare> compare_pairs = { compare };
+    vergesort(queries.begin(), queries.end(), compare_pairs);
+
+    RandomAccessIterator position = first;
+    for (typename std::vector<pair_type>::const_iterator it = queries.begin() ; it != queries.end() ; ++it)
+    {
+        position = vergesort_detail::gallop_lower_bound(position, last, it->first, compare);
+        out[it->second] = position;
+    }
+}
+
+template<typename RandomAccessIterator, typename QueryIterator, typename ResultIterator>
+void batch_lower_bound(RandomAccessIterator first, RandomAccessIterator last,
+                       QueryIterator queries_first, QueryIterator queries_last,
+                       ResultIterator out)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+    batch_lower_bound(first, last, queries_first, queries_last, out, std::less<value_type>());
+}
+
+#endif // VERGESORT_SEARCH_H_
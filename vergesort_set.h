@@ -0,0 +1,401 @@
+/*
+ * vergesort_set.h - set operations on sorted collections
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_SET_H_
+#define VERGESORT_SET_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include "vergesort.h"
+#include "vergesort_simd.h"
+
+// The set operations below have the same semantics as their std::
+// counterparts, including for collections with equivalent elements, but
+// adapt to the shape of their inputs: when one collection is much smaller
+// than the other, every element of the small one is looked up in the big
+// one with a galloping search instead of walking both linearly.
+
+namespace vergesort_detail
+{
+    enum {
+        // Galloping is used when a collection is this many times
+        // bigger than the other one
+        set_gallop_ratio = 16
+    };
+
+    // Finds the first element not less than value by probing positions
+    // 1, 2, 4, 8... after first then binary searching the last interval:
+    // the cost is logarithmic in the distance to the result rather than
+    // in the size of the collection
+    template<typename RandomAccessIterator, typename T, typename Compare>
+    RandomAccessIterator gallop_lower_bound(RandomAccessIterator first, RandomAccessIterator last,
+                                            const T& value, Compare compare)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+        difference_type size = last - first;
+        difference_type step = 1;
+        difference_type low = 0;
+        while (step < size && compare(first[step], value))
+        {
+            low = step;
+            step *= 2;
+        }
+        return std::lower_bound(first + low, first + std::min(step, size), value, compare);
+    }
+
+    // Whether a collection is much smaller than the other one
+    inline bool much_smaller(std::ptrdiff_t size, std::ptrdiff_t other_size)
+    {
+        return size * set_gallop_ratio <= other_size;
+    }
+
+    // Whether the SIMD intersection applies: contiguous collections of
+    // integers compared with std::less
+    template<typename Iterator1, typename Iterator2, typename Compare>
+    struct is_simd_intersectable
+    {
+        typedef typename std::iterator_traits<Iterator1>::value_type value_type;
+        static const bool value = simd::enabled
+                               && std::numeric_limits<value_type>::is_integer
+                               && is_contiguous_simd_iterator<Iterator1, value_type>::value
+                               && is_contiguous_simd_iterator<Iterator2, value_type>::value
+                               && is_same<Compare, std::less<value_type> >::value;
+    };
+
+    // Block intersection: every element of a block of the first collection
+    // is compared to a whole block of the second one at once, then the
+    // block with the smallest last element is replaced. It only works for
+    // collections without equivalent elements, so it stops at the first
+    // duplicate found in either collection and leaves the rest to the
+    // scalar algorithm; first1 and first2 are updated to where it stopped
+    template<typename T, typename OutputIterator>
+    OutputIterator simd_set_intersection(const T*& first1, const T* last1,
+                                         const T*& first2, const T* last2,
+                                         OutputIterator out)
+    {
+        typedef simd::ops<T> ops;
+        while (std::size_t(last1 - first1) > ops::width && std::size_t(last2 - first2) > ops::width)
+        {
+            typename ops::vector block2 = ops::load(first2);
+            if (ops::equal(ops::load(first1), ops::load(first1 + 1)) ||
+                ops::equal(block2, ops::load(first2 + 1))) break;
+
+            unsigned matches = 0;
+            for (std::size_t i = 0 ; i < ops::width ; ++i)
+            {
+                if (ops::equal(ops::broadcast(first1[i]), block2)) matches |= 1u << i;
+            }
+            while (matches)
+            {
+                *out = first1[simd::lowest_bit(matches)];
+                ++out;
+                matches &= matches - 1;
+            }
+
+            T max1 = first1[ops::width - 1];
+            T max2 = first2[ops::width - 1];
+            if (not (max2 < max1)) first1 += ops::width;
+            if (not (max1 < max2)) first2 += ops::width;
+        }
+        return out;
+    }
+
+    template<typename RandomAccessIterator1, typename RandomAccessIterator2,
+             typename OutputIterator, typename Compare>
+    OutputIterator linear_set_intersection(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                           RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                           OutputIterator out, Compare compare, bool_constant<false>)
+    {
+        return std::set_intersection(first1, last1, first2, last2, out, compare);
+    }
+
+    template<typename RandomAccessIterator1, typename RandomAccessIterator2,
+             typename OutputIterator, typename Compare>
+    OutputIterator linear_set_intersection(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                           RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                           OutputIterator out, Compare compare, bool_constant<true>)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator1>::value_type value_type;
+        if (first1 == last1 || first2 == last2) return out;
+
+        const value_type* begin1 = &*first1;
+        const value_type* begin2 = &*first2;
+        const value_type* ptr1 = begin1;
+        const value_type* ptr2 = begin2;
+        out = simd_set_intersection(ptr1, begin1 + (last1 - first1),
+                                    ptr2, begin2 + (last2 - first2), out);
+        return std::set_intersection(first1 + (ptr1 - begin1), last1,
+                                     first2 + (ptr2 - begin2), last2,
+                                     out, compare);
+    }
+
+    template<typename RandomAccessIterator1, typename RandomAccessIterator2,
+             typename OutputIterator, typename Compare>
+    OutputIterator set_intersection(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                    RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                    OutputIterator out, Compare compare,
+                                    std::random_access_iterator_tag)
+    {
+        if (much_smaller(last1 - first1, last2 - first2))
+        {
+            while (first1 != last1)
+            {
+                first2 = gallop_lower_bound(first2, last2, *first1, compare);
+                if (first2 == last2) break;
+                if (not compare(*first1, *first2))
+                {
+                    *out = *first1;
+                    ++out;
+                    ++first2;
+                }
+                ++first1;
+            }
+            return out;
+        }
+
+        if (much_smaller(last2 - first2, last1 - first1))
+        {
+            while (first2 != last2)
+            {
+                first1 = gallop_lower_bound(first1, last1, *first2, compare);
+                if (first1 == last1) break;
+                if (not compare(*first2, *first1))
+                {
+                    *out = *first1;
+                    ++out;
+                    ++first1;
+                }
+                ++first2;
+            }
+            return out;
+        }
+
+        typedef bool_constant<
+            is_simd_intersectable<RandomAccessIterator1, RandomAccessIterator2, Compare>::value
+        > use_simd;
+        return linear_set_intersection(first1, last1, first2, last2, out, compare, use_simd());
+    }
+
+    template<typename RandomAccessIterator1, typename RandomAccessIterator2,
+             typename OutputIterator, typename Compare>
+    OutputIterator set_union(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                             RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                             OutputIterator out, Compare compare,
+                             std::random_access_iterator_tag)
+    {
+        if (much_smaller(last1 - first1, last2 - first2))
+        {
+            for (; first1 != last1 ; ++first1)
+            {
+                RandomAccessIterator2 pos = gallop_lower_bound(first2, last2, *first1, compare);
+                out = std::copy(first2, pos, out);
+                first2 = pos;
+                *out = *first1;
+                ++out;
+                if (first2 != last2 && not compare(*first1, *first2)) ++first2;
+            }
+            return std::copy(first2, last2, out);
+        }
+
+        if (much_smaller(last2 - first2, last1 - first1))
+        {
+            for (; first2 != last2 ; ++first2)
+            {
+                RandomAccessIterator1 pos = gallop_lower_bound(first1, last1, *first2, compare);
+                out = std::copy(first1, pos, out);
+                first1 = pos;
+                if (first1 != last1 && not compare(*first2, *first1))
+                {
+                    *out = *first1;
+                    ++first1;
+                }
+                else
+                {
+                    *out = *first2;
+                }
+                ++out;
+            }
+            return std::copy(first1, last1, out);
+        }
+
+        return std::set_union(first1, last1, first2, last2, out, compare);
+    }
+
+    template<typename RandomAccessIterator1, typename RandomAccessIterator2,
+             typename OutputIterator, typename Compare>
+    OutputIterator set_difference(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                  RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                  OutputIterator out, Compare compare,
+                                  std::random_access_iterator_tag)
+    {
+        if (much_smaller(last1 - first1, last2 - first2))
+        {
+            for (; first1 != last1 ; ++first1)
+            {
+                first2 = gallop_lower_bound(first2, last2, *first1, compare);
+                if (first2 == last2) break;
+                if (not compare(*first1, *first2))
+                {
+                    ++first2;
+                }
+                else
+                {
+                    *out = *first1;
+                    ++out;
+                }
+            }
+            return std::copy(first1, last1, out);
+        }
+
+        if (much_smaller(last2 - first2, last1 - first1))
+        {
+            for (; first2 != last2 ; ++first2)
+            {
+                RandomAccessIterator1 pos = gallop_lower_bound(first1, last1, *first2, compare);
+                out = std::copy(first1, pos, out);
+                first1 = pos;
+                if (first1 == last1) break;
+                if (not compare(*first2, *first1)) ++first1;
+            }
+            return std::copy(first1, last1, out);
+        }
+
+        return std::set_difference(first1, last1, first2, last2, out, compare);
+    }
+
+    // Without random access there is nothing to gallop with
+    template<typename InputIterator1, typename InputIterator2,
+             typename OutputIterator, typename Compare>
+    OutputIterator set_intersection(InputIterator1 first1, InputIterator1 last1,
+                                    InputIterator2 first2, InputIterator2 last2,
+                                    OutputIterator out, Compare compare,
+                                    std::input_iterator_tag)
+    {
+        return std::set_intersection(first1, last1, first2, last2, out, compare);
+    }
+
+    template<typename InputIterator1, typename InputIterator2,
+             typename OutputIterator, typename Compare>
+    OutputIterator set_union(InputIterator1 first1, InputIterator1 last1,
+                             InputIterator2 first2, InputIterator2 last2,
+                             OutputIterator out, Compare compare,
+                             std::input_iterator_tag)
+    {
+        return std::set_union(first1, last1, first2, last2, out, compare);
+    }
+
+    template<typename InputIterator1, typename InputIterator2,
+             typename OutputIterator, typename Compare>
+    OutputIterator set_difference(InputIterator1 first1, InputIterator1 last1,
+                                  InputIterator2 first2, InputIterator2 last2,
+                                  OutputIterator out, Compare compare,
+                                  std::input_iterator_tag)
+    {
+        return std::set_difference(first1, last1, first2, last2, out, compare);
+    }
+
+    template<bool RandomAccess>
+    struct set_category
+    {
+        typedef std::input_iterator_tag type;
+    };
+
+    template<>
+    struct set_category<true>
+    {
+        typedef std::random_access_iterator_tag type;
+    };
+
+    // Random-access category only when both iterators have it
+    template<typename Iterator1, typename Iterator2>
+    struct common_category
+    {
+        typedef typename std::iterator_traits<Iterator1>::iterator_category category1;
+        typedef typename std::iterator_traits<Iterator2>::iterator_category category2;
+        typedef typename set_category<
+            is_same<category1, std::random_access_iterator_tag>::value &&
+            is_same<category2, std::random_access_iterator_tag>::value
+        >::type type;
+    };
+}
+
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator, typename Compare>
+OutputIterator vergesort_set_intersection(InputIterator1 first1, InputIterator1 last1,
+                                          InputIterator2 first2, InputIterator2 last2,
+                                          OutputIterator out, Compare compare)
+{
+    typedef typename vergesort_detail::common_category<InputIterator1, InputIterator2>::type category;
+    return vergesort_detail::set_intersection(first1, last1, first2, last2, out, compare, category());
+}
+
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+OutputIterator vergesort_set_intersection(InputIterator1 first1, InputIterator1 last1,
+                                          InputIterator2 first2, InputIterator2 last2,
+                                          OutputIterator out)
+{
+    typedef typename std::iterator_traits<InputIterator1>::value_type value_type;
+    return vergesort_set_intersection(first1, last1, first2, last2, out, std::less<value_type>());
+}
+
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator, typename Compare>
+OutputIterator vergesort_set_union(InputIterator1 first1, InputIterator1 last1,
+                                   InputIterator2 first2, InputIterator2 last2,
+                                   OutputIterator out, Compare compare)
+{
+    typedef typename vergesort_detail::common_category<InputIterator1, InputIterator2>::type category;
+    return vergesort_detail::set_union(first1, last1, first2, last2, out, compare, category());
+}
+
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+OutputIterator vergesort_set_union(InputIterator1 first1, InputIterator1 last1,
+                                   InputIterator2 first2, InputIterator2 last2,
+                                   OutputIterator out)
+{
+    typedef typename std::iterator_traits<InputIterator1>::value_type value_type;
+    return vergesort_set_union(first1, last1, first2, last2, out, std::less<value_type>());
+}
+
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator, typename Compare>
+OutputIterator vergesort_set_difference(InputIterator1 first1, InputIterator1 last1,
+                                        InputIterator2 first2, InputIterator2 last2,
+                                        OutputIterator out, Compare compare)
+{
+    typedef typename vergesort_detail::common_category<InputIterator1, InputIterator2>::type category;
+    return vergesort_detail::set_difference(first1, last1, first2, last2, out, compare, category());
+}
+
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+OutputIterator vergesort_set_difference(InputIterator1 first1, InputIterator1 last1,
+                                        InputIterator2 first2, InputIterator2 last2,
+                                        OutputIterator out)
+{
+    typedef typename std::iterator_traits<InputIterator1>::value_type value_type;
+    return vergesort_set_difference(first1, last1, first2, last2, out, std::less<value_type>());
+}
+
+#endif // VERGESORT_SET_H_
@@ -0,0 +1,388 @@
+/*
+ * vergesort_simd.h - Portable SIMD layer for the vectorized kernels
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_SIMD_H_
+#define VERGESORT_SIMD_H_
+
+// Every vectorized kernel is written once against simd::ops<T>, which
+// provides the same small set of operations on a native vector of T for
+// each instruction set:
+//
+//     vector          native vector type
+//     width           number of lanes
+//     load(p)         unaligned load of width elements
+//     store(p, v)     unaligned store of width elements
+//     broadcast(x)    every lane set to x
+//     less(a, b)      bitmask, bit i set when a[i] < b[i]
+//     equal(a, b)     bitmask, bit i set when a[i] == b[i]
+//     min(a, b)       lane-wise minimum
+//     max(a, b)       lane-wise maximum
+//
+// Supported element types are int32_t, uint32_t, int64_t, uint64_t,
+// float and double; simd::is_supported<T>::value tells whether ops<T>
+// exists. The backend is chosen from the flags the translation unit is
+// compiled with: AVX-512F, then AVX2, then SSE4.2, then a portable scalar
+// backend emulating 128-bit vectors. Defining VERGESORT_SIMD_SCALAR
+// forces the scalar backend, which makes it possible to test the generic
+// logic of the kernels on any machine. simd::enabled is false when the
+// scalar backend was only picked for lack of a better one: kernels are
+// slower than plain loops then, and callers should not use them.
+
+#include <cstddef>
+#include <stdint.h>
+
+#if !defined(VERGESORT_SIMD_SCALAR)
+    #if defined(__AVX512F__)
+        #define VERGESORT_SIMD_AVX512
+        #include <immintrin.h>
+    #elif defined(__AVX2__)
+        #define VERGESORT_SIMD_AVX2
+        #include <immintrin.h>
+    #elif defined(__SSE4_2__)
+        #define VERGESORT_SIMD_SSE4
+        #include <nmmintrin.h>
+    #else
+        #define VERGESORT_SIMD_SCALAR
+        #define VERGESORT_SIMD_FALLBACK
+    #endif
+#endif
+
+namespace vergesort_detail
+{
+namespace simd
+{
+#if defined(VERGESORT_SIMD_FALLBACK)
+    static const bool enabled = false;
+#else
+    static const bool enabled = true;
+#endif
+
+    template<typename T>
+    struct is_supported
+    {
+        static const bool value = false;
+    };
+
+    #define VERGESORT_SIMD_SUPPORTED(type)  \
+        template<>                          \
+        struct is_supported<type>           \
+        {                                   \
+            static const bool value = true; \
+        };
+
+    VERGESORT_SIMD_SUPPORTED(int32_t)
+    VERGESORT_SIMD_SUPPORTED(uint32_t)
+    VERGESORT_SIMD_SUPPORTED(int64_t)
+    VERGESORT_SIMD_SUPPORTED(uint64_t)
+    VERGESORT_SIMD_SUPPORTED(float)
+    VERGESORT_SIMD_SUPPORTED(double)
+
+    #undef VERGESORT_SIMD_SUPPORTED
+
+    // Index of the lowest bit set, mask must not be 0
+    inline unsigned lowest_bit(unsigned mask)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctz(mask);
+#else
+        unsigned index = 0;
+        while (not (mask & 1u))
+        {
+            mask >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    template<typename T>
+    struct ops;
+
+#if defined(VERGESORT_SIMD_SCALAR)
+
+    // Plain arrays standing for 128-bit vectors, loops the compiler
+    // is free to vectorize on its own
+    template<typename T>
+    struct scalar_vector
+    {
+        T lanes[16 / sizeof(T)];
+    };
+
+    template<typename T>
+    struct scalar_ops
+    {
+        typedef scalar_vector<T> vector;
+        static const std::size_t width = 16 / sizeof(T);
+
+        static vector load(const T* ptr)
+        {
+            vector res;
+            for (std::size_t i = 0 ; i < width ; ++i) res.lanes[i] = ptr[i];
+            return res;
+        }
+
+        static void store(T* ptr, const vector& vec)
+        {
+            for (std::size_t i = 0 ; i < width ; ++i) ptr[i] = vec.lanes[i];
+        }
+
+        static vector broadcast(T value)
+        {
+            vector res;
+            for (std::size_t i = 0 ; i < width ; ++i) res.lanes[i] = value;
+            return res;
+        }
+
+        static unsigned less(const vector& lhs, const vector& rhs)
+        {
+            unsigned mask = 0;
+            for (std::size_t i = 0 ; i < width ; ++i)
+            {
+                mask |= unsigned(lhs.lanes[i] < rhs.lanes[i]) << i;
+            }
+            return mask;
+        }
+
+        static unsigned equal(const vector& lhs, const vector& rhs)
+        {
+            unsigned mask = 0;
+            for (std::size_t i = 0 ; i < width ; ++i)
+            {
+                mask |= unsigned(lhs.lanes[i] == rhs.lanes[i]) << i;
+            }
+            return mask;
+        }
+
+        static vector min(const vector& lhs, const vector& rhs)
+        {
+            vector res;
+            for (std::size_t i = 0 ; i < width ; ++i)
+            {
+                res.lanes[i] = rhs.lanes[i] < lhs.lanes[i] ? rhs.lanes[i] : lhs.lanes[i];
+            }
+            return res;
+        }
+
+        static vector max(const vector& lhs, const vector& rhs)
+        {
+            vector res;
+            for (std::size_t i = 0 ; i < width ; ++i)
+            {
+                res.lanes[i] = lhs.lanes[i] < rhs.lanes[i] ? rhs.lanes[i] : lhs.lanes[i];
+            }
+            return res;
+        }
+    };
+
+    template<> struct ops<int32_t>: scalar_ops<int32_t> {};
+    template<> struct ops<uint32_t>: scalar_ops<uint32_t> {};
+    template<> struct ops<int64_t>: scalar_ops<int64_t> {};
+    template<> struct ops<uint64_t>: scalar_ops<uint64_t> {};
+    template<> struct ops<float>: scalar_ops<float> {};
+    template<> struct ops<double>: scalar_ops<double> {};
+
+#elif defined(VERGESORT_SIMD_AVX512)
+
+    // AVX-512F compares write mask registers directly
+    #define VERGESORT_SIMD_AVX512_INT(type, suffix, usuffix)                                      \
+        template<>                                                                                \
+        struct ops<type>                                                                          \
+        {                                                                                         \
+            typedef __m512i vector;                                                               \
+            static const std::size_t width = 64 / sizeof(type);                                   \
+            static vector load(const type* ptr) { return _mm512_loadu_si512(ptr); }               \
+            static void store(type* ptr, vector vec) { _mm512_storeu_si512(ptr, vec); }           \
+            static vector broadcast(type value) { return _mm512_set1_##suffix(value); }           \
+            static unsigned less(vector lhs, vector rhs)                                          \
+            {                                                                                     \
+                return _mm512_cmplt_##usuffix##_mask(lhs, rhs);                                   \
+            }                                                                                     \
+            static unsigned equal(vector lhs, vector rhs)                                         \
+            {                                                                                     \
+                return _mm512_cmpeq_##suffix##_mask(lhs, rhs);                                    \
+            }                                                                                     \
+            static vector min(vector lhs, vector rhs) { return _mm512_min_##usuffix(lhs, rhs); }  \
+            static vector max(vector lhs, vector rhs) { return _mm512_max_##usuffix(lhs, rhs); }  \
+        };
+
+    VERGESORT_SIMD_AVX512_INT(int32_t, epi32, epi32)
+    VERGESORT_SIMD_AVX512_INT(uint32_t, epi32, epu32)
+    VERGESORT_SIMD_AVX512_INT(int64_t, epi64, epi64)
+    VERGESORT_SIMD_AVX512_INT(uint64_t, epi64, epu64)
+
+    #undef VERGESORT_SIMD_AVX512_INT
+
+    #define VERGESORT_SIMD_AVX512_FLOAT(type, vtype, suffix)                                      \
+        template<>                                                                                \
+        struct ops<type>                                                                          \
+        {                                                                                         \
+            typedef vtype vector;                                                                 \
+            static const std::size_t width = 64 / sizeof(type);                                   \
+            static vector load(const type* ptr) { return _mm512_loadu_##suffix(ptr); }            \
+            static void store(type* ptr, vector vec) { _mm512_storeu_##suffix(ptr, vec); }        \
+            static vector broadcast(type value) { return _mm512_set1_##suffix(value); }           \
+            static unsigned less(vector lhs, vector rhs)                                          \
+            {                                                                                     \
+                return _mm512_cmp_##suffix##_mask(lhs, rhs, _CMP_LT_OQ);                          \
+            }                                                                                     \
+            static unsigned equal(vector lhs, vector rhs)                                         \
+            {                                                                                     \
+                return _mm512_cmp_##suffix##_mask(lhs, rhs, _CMP_EQ_OQ);                          \
+            }                                                                                     \
+            static vector min(vector lhs, vector rhs) { return _mm512_min_##suffix(rhs, lhs); }   \
+            static vector max(vector lhs, vector rhs) { return _mm512_max_##suffix(rhs, lhs); }   \
+        };
+
+    VERGESORT_SIMD_AVX512_FLOAT(float, __m512, ps)
+    VERGESORT_SIMD_AVX512_FLOAT(double, __m512d, pd)
+
+    #undef VERGESORT_SIMD_AVX512_FLOAT
+
+#else // SSE4.2 and AVX2
+
+    // Both instruction sets only compare signed integers: unsigned ones
+    // are compared after flipping their sign bit. Masks are extracted
+    // by reinterpreting lanes as floating point values
+#if defined(VERGESORT_SIMD_AVX2)
+    #define VERGESORT_SIMD_X86(name) _mm256_##name
+    #define VERGESORT_SIMD_X86_INT(name) _mm256_##name##_si256
+    #define VERGESORT_SIMD_X86_CAST(suffix, vec) _mm256_castsi256_##suffix(vec)
+    #define VERGESORT_SIMD_X86_CMP(suffix, lhs, rhs, op, pred) _mm256_cmp_##suffix(lhs, rhs, pred)
+    typedef __m256i x86_int_vector;
+    typedef __m256 x86_float_vector;
+    typedef __m256d x86_double_vector;
+    static const std::size_t x86_vector_size = 32;
+#else
+    #define VERGESORT_SIMD_X86(name) _mm_##name
+    #define VERGESORT_SIMD_X86_INT(name) _mm_##name##_si128
+    #define VERGESORT_SIMD_X86_CAST(suffix, vec) _mm_castsi128_##suffix(vec)
+    #define VERGESORT_SIMD_X86_CMP(suffix, lhs, rhs, op, pred) _mm_cmp##op##_##suffix(lhs, rhs)
+    typedef __m128i x86_int_vector;
+    typedef __m128 x86_float_vector;
+    typedef __m128d x86_double_vector;
+    static const std::size_t x86_vector_size = 16;
+#endif
+
+    template<typename T, bool Is64, bool IsUnsigned>
+    struct x86_int_ops
+    {
+        typedef x86_int_vector vector;
+        static const std::size_t width = x86_vector_size / sizeof(T);
+
+        static vector load(const T* ptr)
+        {
+            return VERGESORT_SIMD_X86_INT(loadu)(reinterpret_cast<const vector*>(ptr));
+        }
+
+        static void store(T* ptr, vector vec)
+        {
+            VERGESORT_SIMD_X86_INT(storeu)(reinterpret_cast<vector*>(ptr), vec);
+        }
+
+        static vector broadcast(T value)
+        {
+            return Is64 ? VERGESORT_SIMD_X86(set1_epi64x)(int64_t(value))
+                        : VERGESORT_SIMD_X86(set1_epi32)(int32_t(value));
+        }
+
+        // All bits set in the lanes where lhs > rhs
+        static vector greater_lanes(vector lhs, vector rhs)
+        {
+            if (IsUnsigned)
+            {
+                vector sign = Is64
+                    ? VERGESORT_SIMD_X86(set1_epi64x)(int64_t(uint64_t(1) << 63))
+                    : VERGESORT_SIMD_X86(set1_epi32)(int32_t(uint32_t(1) << 31));
+                lhs = VERGESORT_SIMD_X86_INT(xor)(lhs, sign);
+                rhs = VERGESORT_SIMD_X86_INT(xor)(rhs, sign);
+            }
+            return Is64 ? VERGESORT_SIMD_X86(cmpgt_epi64)(lhs, rhs)
+                        : VERGESORT_SIMD_X86(cmpgt_epi32)(lhs, rhs);
+        }
+
+        static unsigned to_mask(vector lanes)
+        {
+            return Is64 ? VERGESORT_SIMD_X86(movemask_pd)(VERGESORT_SIMD_X86_CAST(pd, lanes))
+                        : VERGESORT_SIMD_X86(movemask_ps)(VERGESORT_SIMD_X86_CAST(ps, lanes));
+        }
+
+        static unsigned less(vector lhs, vector rhs)
+        {
+            return to_mask(greater_lanes(rhs, lhs));
+        }
+
+        static unsigned equal(vector lhs, vector rhs)
+        {
+            return to_mask(Is64 ? VERGESORT_SIMD_X86(cmpeq_epi64)(lhs, rhs)
+                                : VERGESORT_SIMD_X86(cmpeq_epi32)(lhs, rhs));
+        }
+
+        static vector min(vector lhs, vector rhs)
+        {
+            return VERGESORT_SIMD_X86(blendv_epi8)(lhs, rhs, greater_lanes(lhs, rhs));
+        }
+
+        static vector max(vector lhs, vector rhs)
+        {
+            return VERGESORT_SIMD_X86(blendv_epi8)(rhs, lhs, greater_lanes(lhs, rhs));
+        }
+    };
+
+    template<> struct ops<int32_t>: x86_int_ops<int32_t, false, false> {};
+    template<> struct ops<uint32_t>: x86_int_ops<uint32_t, false, true> {};
+    template<> struct ops<int64_t>: x86_int_ops<int64_t, true, false> {};
+    template<> struct ops<uint64_t>: x86_int_ops<uint64_t, true, true> {};
+
+    #define VERGESORT_SIMD_X86_FLOAT(type, vtype, suffix)                                         \
+        template<>                                                                                \
+        struct ops<type>                                                                          \
+        {                                                                                         \
+            typedef vtype vector;                                                                 \
+            static const std::size_t width = x86_vector_size / sizeof(type);                      \
+            static vector load(const type* ptr) { return VERGESORT_SIMD_X86(loadu_##suffix)(ptr); } \
+            static void store(type* ptr, vector vec) { VERGESORT_SIMD_X86(storeu_##suffix)(ptr, vec); } \
+            static vector broadcast(type value) { return VERGESORT_SIMD_X86(set1_##suffix)(value); } \
+            static unsigned less(vector lhs, vector rhs)                                          \
+            {                                                                                     \
+                return VERGESORT_SIMD_X86(movemask_##suffix)(VERGESORT_SIMD_X86_CMP(suffix, lhs, rhs, lt, _CMP_LT_OQ)); \
+            }                                                                                     \
+            static unsigned equal(vector lhs, vector rhs)                                         \
+            {                                                                                     \
+                return VERGESORT_SIMD_X86(movemask_##suffix)(VERGESORT_SIMD_X86_CMP(suffix, lhs, rhs, eq, _CMP_EQ_OQ)); \
+            }                                                                                     \
+            static vector min(vector lhs, vector rhs) { return VERGESORT_SIMD_X86(min_##suffix)(rhs, lhs); } \
+            static vector max(vector lhs, vector rhs) { return VERGESORT_SIMD_X86(max_##suffix)(rhs, lhs); } \
+        };
+
+    VERGESORT_SIMD_X86_FLOAT(float, x86_float_vector, ps)
+    VERGESORT_SIMD_X86_FLOAT(double, x86_double_vector, pd)
+
+    #undef VERGESORT_SIMD_X86_FLOAT
+
+#endif
+}
+}
+
+#endif // VERGESORT_SIMD_H_
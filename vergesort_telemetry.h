@@ -0,0 +1,308 @@
+/*
+ * vergesort_telemetry.h - sampled profiles of vergesort calls
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_TELEMETRY_H_
+#define VERGESORT_TELEMETRY_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "vergesort.h"
+
+// Profile of a single sampled vergesort call
+struct vergesort_sample
+{
+    // Number of elements sorted
+    std::uint64_t size;
+
+    // sizeof of the elements
+    std::uint64_t element_size;
+
+    // What the scan found, see vergesort_detail::vergesort_stats; only
+    // gathered for random-access iterators, zero otherwise
+    std::uint64_t runs;
+    std::uint64_t descending_runs;
+    std::uint64_t fallback_size;
+
+    // Wall-clock time of the call
+    std::uint64_t elapsed_ns;
+
+    // Fraction of the elements sorted by the fallback pdqsort
+    double fallback_fraction() const
+    {
+        return size ? double(fallback_size) / double(size) : 0.0;
+    }
+};
+
+namespace vergesort_detail
+{
+    // Fields of a ring buffer slot, each one atomic so that a reader
+    // racing with a writer reads garbage instead of causing undefined
+    // behaviour; the sequence number tells whether the garbage has to
+    // be thrown away
+    struct telemetry_slot
+    {
+        // 0 if never written, 2 * index + 1 while being written,
+        // 2 * index + 2 once sample index is complete
+        std::atomic<std::uint64_t> sequence;
+        std::atomic<std::uint64_t> fields[6];
+
+        telemetry_slot():
+            sequence(0)
+        {
+            for (std::atomic<std::uint64_t>& field: fields)
+            {
+                field.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    enum {
+        // Number of call counters of a vergesort_telemetry instance,
+        // threads beyond that share them
+        telemetry_counters = 64
+    };
+
+    // Call counter of a thread, alone in its cache line so that
+    // threads counting their calls do not contend
+    struct telemetry_counter
+    {
+        std::atomic<std::uint64_t> calls;
+        char padding[64 - sizeof(std::atomic<std::uint64_t>)];
+
+        telemetry_counter():
+            calls(0)
+        {}
+    };
+
+    // Index of the current thread, given in order of first use
+    inline std::size_t telemetry_thread_index()
+    {
+        static std::atomic<std::size_t> next(0);
+        thread_local std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+}
+
+// Opt-in sampling of vergesort calls: one call out of sample_interval
+// of every thread is profiled and its profile is written to a fixed-size ring buffer,
+// overwriting the oldest ones. Recording and dumping are lock-free and
+// may happen from any number of threads at once, though a sample can be
+// garbled if more than capacity samples are recorded at the same time.
+class vergesort_telemetry
+{
+    public:
+
+        // capacity is rounded up to a power of 2; a sample_interval
+        // of 0 disables sampling
+        explicit vergesort_telemetry(unsigned sample_interval = 1024,
+                                     std::size_t capacity = 4096):
+            sample_interval_(sample_interval),
+            counters_(new vergesort_detail::telemetry_counter[vergesort_detail::telemetry_counters]),
+            head_(0)
+        {
+            std::size_t size = 1;
+            while (size < capacity) size *= 2;
+            mask_ = size - 1;
+            slots_.reset(new vergesort_detail::telemetry_slot[size]);
+        }
+
+        vergesort_telemetry(const vergesort_telemetry&) = delete;
+        vergesort_telemetry& operator=(const vergesort_telemetry&) = delete;
+
+        void set_sample_interval(unsigned sample_interval)
+        {
+            sample_interval_.store(sample_interval, std::memory_order_relaxed);
+        }
+
+        unsigned sample_interval() const
+        {
+            return sample_interval_.load(std::memory_order_relaxed);
+        }
+
+        // Sorts the collection with vergesort, profiling the call
+        // if it is sampled
+        template<typename BidirectionalIterator, typename Compare>
+        void sort(BidirectionalIterator first, BidirectionalIterator last, Compare compare)
+        {
+            typedef typename std::iterator_traits<BidirectionalIterator>::iterator_category category;
+            typedef typename std::iterator_traits<BidirectionalIterator>::value_type value_type;
+
+            if (not sampled())
+            {
+                vergesort_detail::vergesort(first, last, compare, category());
+                return;
+            }
+
+            vergesort_sample sample = {};
+            sample.size = std::distance(first, last);
+            sample.element_size = sizeof(value_type);
+
+            vergesort_detail::vergesort_stats stats;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            vergesort_detail::vergesort(first, last, compare, &stats, category());
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            sample.runs = stats.runs;
+            sample.descending_runs = stats.descending_runs;
+            sample.fallback_size = stats.fallback_size;
+            sample.elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            record(sample);
+        }
+
+        template<typename BidirectionalIterator>
+        void sort(BidirectionalIterator first, BidirectionalIterator last)
+        {
+            typedef typename std::iterator_traits<BidirectionalIterator>::value_type value_type;
+            sort(first, last, std::less<value_type>());
+        }
+
+        // Writes a sample to the ring buffer
+        void record(const vergesort_sample& sample)
+        {
+            std::uint64_t index = head_.fetch_add(1, std::memory_order_relaxed);
+            vergesort_detail::telemetry_slot& slot = slots_[index & mask_];
+
+            slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.fields[0].store(sample.size, std::memory_order_relaxed);
+            slot.fields[1].store(sample.element_size, std::memory_order_relaxed);
+            slot.fields[2].store(sample.runs, std::memory_order_relaxed);
+            slot.fields[3].store(sample.descending_runs, std::memory_order_relaxed);
+            slot.fields[4].store(sample.fallback_size, std::memory_order_relaxed);
+            slot.fields[5].store(sample.elapsed_ns, std::memory_order_relaxed);
+            slot.sequence.store(2 * index + 2, std::memory_order_release);
+        }
+
+        // Samples currently in the ring buffer, oldest first; samples
+        // being overwritten while they are read are skipped
+        std::vector<vergesort_sample> snapshot() const
+        {
+            std::vector<vergesort_sample> samples;
+            std::uint64_t head = head_.load(std::memory_order_acquire);
+            std::uint64_t capacity = mask_ + 1;
+            std::uint64_t index = head > capacity ? head - capacity : 0;
+
+            for (; index < head ; ++index)
+            {
+                const vergesort_detail::telemetry_slot& slot = slots_[index & mask_];
+                if (slot.sequence.load(std::memory_order_acquire) != 2 * index + 2) continue;
+
+                vergesort_sample sample;
+                sample.size = slot.fields[0].load(std::memory_order_relaxed);
+                sample.element_size = slot.fields[1].load(std::memory_order_relaxed);
+                sample.runs = slot.fields[2].load(std::memory_order_relaxed);
+                sample.descending_runs = slot.fields[3].load(std::memory_order_relaxed);
+                sample.fallback_size = slot.fields[4].load(std::memory_order_relaxed);
+                sample.elapsed_ns = slot.fields[5].load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != 2 * index + 2) continue;
+                samples.push_back(sample);
+            }
+            return samples;
+        }
+
+        // Writes the samples as tab-separated values, one per line,
+        // preceded by a header line
+        void dump(std::ostream& out) const
+        {
+            out << "size\telement_size\truns\tdescending_runs\tfallback_size\tfallback_fraction\telapsed_ns\n";
+            std::vector<vergesort_sample> samples = snapshot();
+            for (const vergesort_sample& sample: samples)
+            {
+                out << sample.size << '\t'
+                    << sample.element_size << '\t'
+                    << sample.runs << '\t'
+                    << sample.descending_runs << '\t'
+                    << sample.fallback_size << '\t'
+                    << sample.fallback_fraction() << '\t'
+                    << sample.elapsed_ns << '\n';
+            }
+        }
+
+        // Number of calls seen, sampled or not
+        std::uint64_t calls() const
+        {
+            std::uint64_t res = 0;
+            for (std::size_t i = 0 ; i < vergesort_detail::telemetry_counters ; ++i)
+            {
+                res += counters_[i].calls.load(std::memory_order_relaxed);
+            }
+            return res;
+        }
+
+        // Number of samples recorded since the creation
+        std::uint64_t recorded() const
+        {
+            return head_.load(std::memory_order_relaxed);
+        }
+
+    private:
+
+        // Every thread counts its calls on its own counter, and samples
+        // the first one then every sample_interval-th one
+        bool sampled()
+        {
+            unsigned interval = sample_interval_.load(std::memory_order_relaxed);
+            std::size_t thread = vergesort_detail::telemetry_thread_index();
+            std::atomic<std::uint64_t>& calls = counters_[thread % vergesort_detail::telemetry_counters].calls;
+            std::uint64_t call = calls.fetch_add(1, std::memory_order_relaxed);
+            return interval != 0 && call % interval == 0;
+        }
+
+        std::atomic<unsigned> sample_interval_;
+        std::unique_ptr<vergesort_detail::telemetry_counter[]> counters_;
+        std::atomic<std::uint64_t> head_;
+        std::uint64_t mask_;
+        std::unique_ptr<vergesort_detail::telemetry_slot[]> slots_;
+};
+
+// Process-wide telemetry, disabled until given a sample interval
+inline vergesort_telemetry& vergesort_default_telemetry()
+{
+    static vergesort_telemetry telemetry(0);
+    return telemetry;
+}
+
+template<typename BidirectionalIterator, typename Compare>
+void vergesort_sampled(BidirectionalIterator first, BidirectionalIterator last, Compare compare)
+{
+    vergesort_default_telemetry().sort(first, last, compare);
+}
+
+template<typename BidirectionalIterator>
+void vergesort_sampled(BidirectionalIterator first, BidirectionalIterator last)
+{
+    vergesort_default_telemetry().sort(first, last);
+}
+
+#endif // VERGESORT_TELEMETRY_H_
@@ -0,0 +1,190 @@
+/*
+ * vergesort_topk.h - top-k of an unbounded stream
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_TOPK_H_
+#define VERGESORT_TOPK_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "pdqsort.h"
+
+namespace vergesort_detail
+{
+    // Quickselect built on the pdqsort partitioning: after the call,
+    // *nth is the element that would be there if [first, last) was
+    // sorted, with no greater element before it and no smaller one
+    // after it. Falls back to std::nth_element when too many bad
+    // partitions are encountered
+    template<typename RandomAccessIterator, typename Compare>
+    void pdq_select(RandomAccessIterator first, RandomAccessIterator nth,
+                    RandomAccessIterator last, Compare compare)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::difference_type difference_type;
+        if (last - first < 2) return;
+        int bad_allowed = pdqsort_detail::log2(last - first);
+
+        while (last - first >= pdqsort_detail::insertion_sort_threshold)
+        {
+            difference_type size = last - first;
+            pdqsort_detail::sort3(first + size / 2, first, last - 1, compare);
+            RandomAccessIterator pivot_pos = pdqsort_detail::partition_right(first, last, compare).first;
+
+            difference_type l_size = pivot_pos - first;
+            difference_type r_size = last - (pivot_pos + 1);
+            if (l_size < size / 8 || r_size < size / 8)
+            {
+                // Many equivalent elements or an adversarial pattern
+                if (--bad_allowed == 0)
+                {
+                    std::nth_element(first, nth, last, compare);
+                    return;
+                }
+                if (l_size >= pdqsort_detail::insertion_sort_threshold)
+                {
+                    std::iter_swap(first, first + l_size / 4);
+                    std::iter_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+                }
+                if (r_size >= pdqsort_detail::insertion_sort_threshold)
+                {
+                    std::iter_swap(pivot_pos + 1, pivot_pos + 1 + r_size / 4);
+                    std::iter_swap(last - 1, last - r_size / 4);
+                }
+            }
+
+            if (nth == pivot_pos) return;
+            if (nth < pivot_pos) last = pivot_pos;
+            else first = pivot_pos + 1;
+        }
+        pdqsort_detail::insertion_sort(first, last, compare);
+    }
+}
+
+// Accumulator keeping the k elements of a stream that would come first
+// if the whole stream was sorted with compare (the k smallest ones with
+// std::less, the k greatest ones with std::greater). Incoming elements
+// are buffered; when the buffer is full, the k best elements are selected
+// with a quickselect and the k-th one becomes a threshold under which
+// new elements are discarded with a single comparison
+template<typename T, typename Compare = std::less<T> >
+class verge_topk
+{
+    public:
+
+        // The buffer holds batch_size elements on top of the k best
+        // ones, defaults to max(k, 1024)
+        explicit verge_topk(std::size_t k, Compare compare = Compare(), std::size_t batch_size = 0):
+            k_(k),
+            batch_size_(batch_size ? batch_size : std::max<std::size_t>(k, 1024)),
+            compare_(compare),
+            has_threshold_(false)
+        {
+            buffer_.reserve(k_ + batch_size_);
+        }
+
+        void push(const T& value)
+        {
+            if (k_ == 0) return;
+            if (has_threshold_ && not compare_(value, buffer_[k_ - 1])) return;
+            buffer_.push_back(value);
+            if (buffer_.size() >= k_ + batch_size_) compact();
+        }
+
+        template<typename InputIterator>
+        void push(InputIterator first, InputIterator last)
+        {
+            for (; first != last ; ++first)
+            {
+                push(*first);
+            }
+        }
+
+        // Number of elements currently kept, at most k
+        std::size_t size() const
+        {
+            return std::min(buffer_.size(), k_);
+        }
+
+        std::size_t k() const
+        {
+            return k_;
+        }
+
+        // Whether elements are currently filtered, and the element they
+        // are compared to; only elements comparing less than the
+        // threshold can still enter the top-k
+        bool has_threshold() const
+        {
+            return has_threshold_;
+        }
+
+        const T& threshold() const
+        {
+            return buffer_[k_ - 1];
+        }
+
+        // The best elements seen so far, sorted
+        std::vector<T> sorted() const
+        {
+            std::vector<T> result(buffer_);
+            if (result.size() > k_)
+            {
+                vergesort_detail::pdq_select(result.begin(), result.begin() + (k_ - 1),
+                                             result.end(), compare_);
+                result.erase(result.begin() + k_, result.end());
+            }
+            pdqsort(result.begin(), result.end(), compare_);
+            return result;
+        }
+
+        void clear()
+        {
+            buffer_.clear();
+            has_threshold_ = false;
+        }
+
+    private:
+
+        // Keep the k best elements of the buffer; the k-th one stays at
+        // index k - 1 and becomes the new threshold
+        void compact()
+        {
+            typename std::vector<T>::iterator nth = buffer_.begin() + (k_ - 1);
+            vergesort_detail::pdq_select(buffer_.begin(), nth, buffer_.end(), compare_);
+            has_threshold_ = true;
+            buffer_.erase(nth + 1, buffer_.end());
+        }
+
+        std::size_t k_;
+        std::size_t batch_size_;
+        Compare compare_;
+        bool has_threshold_;
+        std::vector<T> buffer_;
+};
+
+#endif // VERGESORT_TOPK_H_
@@ -0,0 +1,119 @@
+/*
+ * vergesort_writes.h - sorting with as few element writes as possible
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Morwenn <morwenn29@hotmail.fr>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef VERGESORT_WRITES_H_
+#define VERGESORT_WRITES_H_
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "vergesort.h"
+
+namespace vergesort_detail
+{
+    // Compares positions of a collection by the elements they hold,
+    // ties being broken by position so that equivalent elements that
+    // are already in order do not move
+    template<typename RandomAccessIterator, typename Compare>
+    struct compare_positions
+    {
+        RandomAccessIterator first;
+        Compare compare;
+
+        bool operator()(std::size_t lhs, std::size_t rhs) const
+        {
+            if (compare(first[lhs], first[rhs])) return true;
+            if (compare(first[rhs], first[lhs])) return false;
+            return lhs < rhs;
+        }
+    };
+
+    // Moves the elements so that position i receives the element that
+    // was at position order[i], following every cycle of the permutation
+    // with a single temporary: elements already in place are not touched
+    // and every other element is written exactly once. Returns the number
+    // of elements written, order is left as the identity
+    template<typename RandomAccessIterator>
+    std::size_t apply_permutation(RandomAccessIterator first, std::vector<std::size_t>& order)
+    {
+        typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+
+        std::size_t writes = 0;
+        for (std::size_t start = 0 ; start < order.size() ; ++start)
+        {
+            if (order[start] == start) continue;
+
+            value_type tmp = std::move(first[start]);
+            std::size_t current = start;
+            while (order[current] != start)
+            {
+                std::size_t next = order[current];
+                first[current] = std::move(first[next]);
+                order[current] = current;
+                current = next;
+                ++writes;
+            }
+            first[current] = std::move(tmp);
+            order[current] = current;
+            ++writes;
+        }
+        return writes;
+    }
+}
+
+// Sorts [first, last) writing every element at most once, and only when it
+// is not already at its final position, which is the smallest possible
+// number of writes: for collections living in memory where writes cost much
+// more than reads (memory-mapped files on flash, persistent memory). The
+// positions of the elements are sorted with vergesort, then the permutation
+// is applied by following its cycles. Needs n extra words of memory and
+// reads the elements more than vergesort would. Equivalent elements keep
+// their relative order. Returns the number of elements written
+template<typename RandomAccessIterator, typename Compare>
+std::size_t vergesort_min_writes(RandomAccessIterator first, RandomAccessIterator last,
+                                 Compare compare)
+{
+    std::size_t size = std::distance(first, last);
+    std::vector<std::size_t> order(size);
+    for (std::size_t i = 0 ; i < size ; ++i)
+    {
+        order[i] = i;
+    }
+
+    vergesort_detail::compare_positions<RandomAccessIterator, Compare> compare_order = { first, compare };
+    vergesort(order.begin(), order.end(), compare_order);
+    return vergesort_detail::apply_permutation(first, order);
+}
+
+template<typename RandomAccessIterator>
+std::size_t vergesort_min_writes(RandomAccessIterator first, RandomAccessIterator last)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+    return vergesort_min_writes(first, last, std::less<value_type>());
+}
+
+#endif // VERGESORT_WRITES_H_